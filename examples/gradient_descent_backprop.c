@@ -1,32 +1,34 @@
-#include "mx.h"
-
-float forward(NN* nn){
-    for(size_t i = 0; i < nn->count; ++i){
-        DOT(nn->as[i+1], nn->as[i], nn->ws[i]);
-        ADD(nn->as[i+1], nn->bs[i]);
-        mx_apply_sigmoid(nn->as[i+1]);
-    }
-    return SCALAR(nn->as[nn->count]);
-}
-
-float dcost(NN* nn, NN* g, Matrix* ti, Matrix* to){
-    assert(ti->rows==to->rows);
-    assert(to->cols == nn->as[nn->count]->cols); 
-    
-
-}
+#include "../mx.h"
+#include <time.h>
 
 int main(void){
-    size_t arch[] = {2,2,1};
-    NN* nn = NN(arch);
-    NN* g = NN(arch);
-    mx_nn_set_to_rand(nn,0,1);
-    mx_nn_set_to_rand(g,0,1);
+    srand(time(NULL));
+
+    size_t arch[] = {2,2,1};  // 2 input neuron 2 hidden 1 output
+    NN* xor = NN(arch);
+    NN* gradient = NN(arch);
+    mx_nn_set_to_rand(xor,0,1);
     Matrix* xor_data = open_dataset("./datasets/XOR");
-    Matrix* x;
-    COL_SLICE(x, xor_data, 0);
-    Matrix* y;
-    COL_SLICE(y, xor_data, 2);
+    Matrix* ti = COL_SLICE(xor_data,0,1);       // Slice x
+    Matrix* to = COL_SLICE(xor_data,2,2);       // Slice y
 
+    float rate = 1;
+    for(size_t i = 0; i<20000; ++i){
+        mx_nn_backprop(xor, gradient, ti, to);  // one forward and one backward pass per sample
+        mx_nn_learn(xor, gradient, rate);
+        if(i % 1000 == 0){
+            printf("%zu cost = %f\n",i, mx_nn_cost(xor,ti,to));
+        }
+    }
+    mx_nn_forward_batch(xor, ti);   // the whole dataset in one pass
+    for(size_t i = 0; i < ti->rows; ++i){
+        printf("%.0f ^ %.0f = %f\n", AT(ti,i,0), AT(ti,i,1), round(AT(xor->as[xor->count],i,0)));
+    }
+    PRINTNN(xor);
+    mx_nn_free(xor);
+    mx_nn_free(gradient);
+    mx_free(xor_data);
+    mx_free(ti);
+    mx_free(to);
     return 0;
-}
\ No newline at end of file
+}
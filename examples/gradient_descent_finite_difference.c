@@ -3,9 +3,7 @@
 
 float forward_xor(NN *xor){
     for(size_t i = 0; i < xor->count; ++i){
-        DOT(xor->as[i+1], xor->as[i],xor->ws[i]);
-        ADD(xor->as[i+1],xor->bs[i]);
-        mx_apply_function(xor->as[i+1], sigmoidf);
+        mx_dense_forward(xor->as[i+1], xor->as[i], xor->ws[i], xor->bs[i], MX_OP_SIGMOID);
     }
     return SCALAR(xor->as[xor->count]);
 }
@@ -1,5 +1,11 @@
 
 #include "mx.h"
+#include <stdatomic.h>
+#include <unistd.h>
+#include <float.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 float sigmoidf(float value){
     return 1.0/(1+expf(-value));
@@ -19,643 +25,3557 @@ void swap(float *a, float *b) {
     *a = *a - *b;
 }
 
-void mx_free(Matrix *matrix) {
-    if (matrix)  {
-        if(matrix->container){
-            matrix->container->ref_count--;
-            if (matrix->container->ref_count == 0) {
-                if (matrix->container->data) {
-                    MX_FREE(matrix->container->data);
-                    matrix->container->data = NULL;
-                }
-                MX_FREE(matrix->container);
-                matrix->container = NULL;
-            }
-        }
-        MX_FREE(matrix);  
-    }
+// Persistent worker pool behind mx_parallel_for. Workers spin briefly on the
+// job generation counter before sleeping, so back-to-back kernels (e.g. the
+// layers of a forward pass) are dispatched without a syscall.
+#define MX_POOL_SPIN 4096
+
+static struct {
+    pthread_mutex_t submit;    // one parallel region at a time
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    pthread_t* workers;
+    size_t worker_count;
+    size_t num_threads;        // requested size, 0 -> default
+    size_t spin;
+    uint8_t running;
+    uint8_t exit_registered;
+    atomic_uint generation;
+    atomic_uint stopping;
+    atomic_size_t next;
+    atomic_size_t active;
+    mx_parallel_fn func;
+    void* arg;
+    size_t count;
+    size_t grain;
+    size_t chunks;
+} __mx_pool = {
+    .submit = PTHREAD_MUTEX_INITIALIZER,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+};
+
+// non-zero inside a parallel region; nested regions run serially
+static _Thread_local uint8_t __mx_pool_depth = 0;
+
+static inline void __mx_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
 }
 
-void mx_apply_sigmoid(Matrix* matrix){
-    mx_apply_function(matrix, sigmoidf);
+static size_t __mx_online_cpus(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (size_t)cpus : 1;
 }
 
-void mx_apply_function(Matrix* matrix, float (*func)(float)) {
-    if(CHECK_MATRIX_VALIDITY(matrix) == -1){
-        errno = EINVAL;
-        perror("Got an ivalid matrix when tried to apply function.");
+size_t mx_get_num_threads(void) {
+    if (__mx_pool.num_threads) {
+        return __mx_pool.num_threads;
     }
+    size_t cpus = __mx_online_cpus();
+    return cpus < THREAD_COUNT ? cpus : THREAD_COUNT;
+}
 
-    for(size_t i = 0; i < matrix->rows; ++i) {
-        for(size_t j = 0; j < matrix->cols; ++j) {
-            AT(matrix,i,j)= func(AT(matrix,i,j));
-        }
+static void __mx_pool_run_chunks(void) {
+    size_t chunk;
+    while ((chunk = atomic_fetch_add(&__mx_pool.next, 1)) < __mx_pool.chunks) {
+        size_t start = chunk * __mx_pool.grain;
+        size_t end = __mx_pool.count - start < __mx_pool.grain ? __mx_pool.count : start + __mx_pool.grain;
+        __mx_pool.func(start, end, __mx_pool.arg);
     }
 }
 
-uint8_t mx_apply_function_to_both(Matrix* matrix1,Matrix* matrix2, float (*func)(float, float)) {
-    if(CHECK_MATRIX_VALIDITY(matrix1) == -1){
-        return -1;
-    }
-    if(matrix1->rows != matrix2->rows || matrix1->cols != matrix2->cols) {
-        printf("Error: matrices have different dimensions.\n");
-        return -1;
-    }
-    Matrix* result = matrix1;
-    for(size_t i = 0; i < matrix1->rows; ++i) {
-        for(size_t j = 0; j < matrix1->cols; ++j) {
-            AT(result, i, j) = func(AT(matrix1, i, j), AT(matrix2, i, j));
+static void* __mx_pool_worker(void* arg) {
+    unsigned seen = (unsigned)(uintptr_t)arg;
+    __mx_pool_depth = 1;
+    for (;;) {
+        unsigned gen;
+        size_t spins = 0;
+        while ((gen = atomic_load_explicit(&__mx_pool.generation, memory_order_acquire)) == seen) {
+            if (spins++ < __mx_pool.spin) {
+                __mx_cpu_relax();
+                continue;
+            }
+            pthread_mutex_lock(&__mx_pool.lock);
+            while ((gen = atomic_load(&__mx_pool.generation)) == seen) {
+                pthread_cond_wait(&__mx_pool.wake, &__mx_pool.lock);
+            }
+            pthread_mutex_unlock(&__mx_pool.lock);
+            break;
+        }
+        seen = gen;
+        if (atomic_load(&__mx_pool.stopping)) {
+            return NULL;
+        }
+
+        __mx_pool_run_chunks();
+
+        if (atomic_fetch_sub(&__mx_pool.active, 1) == 1) {
+            pthread_mutex_lock(&__mx_pool.lock);
+            pthread_cond_signal(&__mx_pool.done);
+            pthread_mutex_unlock(&__mx_pool.lock);
         }
     }
-    return 0;
 }
 
-Matrix* mx_apply_function_to_both_new(Matrix* matrix1,Matrix* matrix2, float (*func)(float, float)) {
-    if(CHECK_MATRIX_VALIDITY(matrix1) == -1){
-        return NULL;
+// caller must hold __mx_pool.submit
+static void __mx_pool_stop(void) {
+    if (!__mx_pool.running) {
+        return;
     }
-    if(matrix1->rows != matrix2->rows || matrix1->cols != matrix2->cols) {
-        printf("Error: matrices have different dimensions.\n");
-        return NULL;
+    pthread_mutex_lock(&__mx_pool.lock);
+    atomic_store(&__mx_pool.stopping, 1);
+    atomic_fetch_add(&__mx_pool.generation, 1);
+    pthread_cond_broadcast(&__mx_pool.wake);
+    pthread_mutex_unlock(&__mx_pool.lock);
+
+    for (size_t i = 0; i < __mx_pool.worker_count; ++i) {
+        pthread_join(__mx_pool.workers[i], NULL);
     }
-    Matrix* result = MATRIX(matrix1->rows, matrix1->cols);
-    for(size_t i = 0; i < matrix1->rows; ++i) {
-        for(size_t j = 0; j < matrix1->cols; ++j) {
-            AT(result, i, j) = func(AT(matrix1, i, j), AT(matrix2, i, j));
+    MX_FREE(__mx_pool.workers);
+    __mx_pool.workers = NULL;
+    __mx_pool.worker_count = 0;
+    __mx_pool.running = 0;
+    atomic_store(&__mx_pool.stopping, 0);
+}
+
+// caller must hold __mx_pool.submit
+static uint8_t __mx_pool_start(void) {
+    size_t threads = mx_get_num_threads();
+    // the submitting thread works too, so it is not counted as a worker
+    __mx_pool.workers = MX_MALLOC(sizeof(*__mx_pool.workers) * (threads - 1));
+    if (!__mx_pool.workers) {
+        return 0;
+    }
+    // spinning only pays off when every worker has a core of its own
+    __mx_pool.spin = threads <= __mx_online_cpus() ? MX_POOL_SPIN : 0;
+
+    unsigned gen = atomic_load(&__mx_pool.generation);
+    for (size_t i = 0; i < threads - 1; ++i) {
+        if (pthread_create(&__mx_pool.workers[i], NULL, __mx_pool_worker, (void*)(uintptr_t)gen) != 0) {
+            break;
         }
+        __mx_pool.worker_count++;
     }
-    return result;
+    __mx_pool.running = 1;
+    if (__mx_pool.worker_count == 0) {
+        __mx_pool_stop();
+        return 0;
+    }
+    if (!__mx_pool.exit_registered) {
+        atexit(mx_thread_pool_shutdown);
+        __mx_pool.exit_registered = 1;
+    }
+    return 1;
 }
 
-__matrix_container* __init_container(float* array, size_t size) {
-    if(size == 0){
-        return NULL;
+void mx_set_num_threads(size_t count) {
+    pthread_mutex_lock(&__mx_pool.submit);
+    __mx_pool_stop();
+    __mx_pool.num_threads = count;
+    pthread_mutex_unlock(&__mx_pool.submit);
+}
+
+void mx_thread_pool_shutdown(void) {
+    pthread_mutex_lock(&__mx_pool.submit);
+    __mx_pool_stop();
+    pthread_mutex_unlock(&__mx_pool.submit);
+}
+
+void mx_parallel_for(size_t count, size_t grain, mx_parallel_fn func, void* arg) {
+    if (count == 0) {
+        return;
     }
-    
-    __matrix_container* container = MX_MALLOC(sizeof(__matrix_container));
-    if (!container) {
-        return NULL;
+    if (grain == 0) {
+        grain = 1;
+    }
+    size_t chunks = (count + grain - 1) / grain;
+    if (chunks < 2 || __mx_pool_depth || mx_get_num_threads() < 2 || pthread_mutex_trylock(&__mx_pool.submit) != 0) {
+        func(0, count, arg);
+        return;
+    }
+    if (!__mx_pool.running && !__mx_pool_start()) {
+        pthread_mutex_unlock(&__mx_pool.submit);
+        func(0, count, arg);
+        return;
     }
 
-    container->ref_count = 1;
+    __mx_pool.func = func;
+    __mx_pool.arg = arg;
+    __mx_pool.count = count;
+    __mx_pool.grain = grain;
+    __mx_pool.chunks = chunks;
+    atomic_store(&__mx_pool.next, 0);
+    atomic_store(&__mx_pool.active, __mx_pool.worker_count);
 
-    container->size = size;
+    pthread_mutex_lock(&__mx_pool.lock);
+    atomic_fetch_add_explicit(&__mx_pool.generation, 1, memory_order_release);
+    pthread_cond_broadcast(&__mx_pool.wake);
+    pthread_mutex_unlock(&__mx_pool.lock);
 
-    // Always allocate memory on the heap
-    container->data = calloc(size, sizeof(*container->data));
-    
-    if (!container->data) {
-        MX_FREE(container);
-        return NULL;
-    }
+    __mx_pool_depth = 1;
+    __mx_pool_run_chunks();
+    __mx_pool_depth = 0;
 
-    // If an external array is provided, copy the data over
-    if (array) {
-        memcpy(container->data, array, size * sizeof(*container->data));
+    for (size_t spins = 0; atomic_load(&__mx_pool.active) != 0 && spins < __mx_pool.spin; ++spins) {
+        __mx_cpu_relax();
     }
-
-    return container;
+    if (atomic_load(&__mx_pool.active) != 0) {
+        pthread_mutex_lock(&__mx_pool.lock);
+        while (atomic_load(&__mx_pool.active) != 0) {
+            pthread_cond_wait(&__mx_pool.done, &__mx_pool.lock);
+        }
+        pthread_mutex_unlock(&__mx_pool.lock);
+    }
+    pthread_mutex_unlock(&__mx_pool.submit);
 }
 
-NN* __mx_nn_alloc(size_t* arch, size_t arch_count){
-    
-    // Validate the input parameters
-    if (arch == NULL || arch_count == 0) {
-        // Some error handling mechanism should be in place, like returning a null NN or aborting.
-        // For simplicity, I'm using a dummy assert here.
-        MX_ASSERT(0); 
-    }
-    
-    NN* nn = (NN*)MX_MALLOC(sizeof(NN));
-    nn->count = arch_count - 1;
+// Opt-in buffer pool. Freed matrix blocks and GEMM scratch are kept in free
+// lists keyed by their exact byte size, so loops that keep producing the same
+// shapes stop calling MX_MALLOC once every size has been seen.
+typedef struct {
+    size_t bytes;           // 0 for an unused bucket
+    void* head;             // free list linked through the first word of each buffer
+    size_t count;
+} __mx_buffer_bucket;
 
-    // Allocate memory for weight matrices
-    nn->ws = MX_MALLOC(sizeof(*nn->ws) * nn->count);
-    MX_ASSERT(nn->ws != NULL);
+// buckets are found by masking a hash
+_Static_assert(MX_BUFFER_POOL_BUCKETS > 0 && (MX_BUFFER_POOL_BUCKETS & (MX_BUFFER_POOL_BUCKETS - 1)) == 0,
+               "MX_BUFFER_POOL_BUCKETS must be a power of two");
 
-    // Allocate memory for bias vectors
-    nn->bs = MX_MALLOC(sizeof(*nn->bs) * nn->count);
-    MX_ASSERT(nn->bs != NULL);
+static struct {
+    pthread_mutex_t lock;
+    atomic_uint enabled;
+    uint8_t exit_registered;
+    mx_buffer_pool_stats stats;
+    __mx_buffer_bucket buckets[MX_BUFFER_POOL_BUCKETS];
+} __mx_buffers = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
 
-    // Allocate memory for activation values
-    nn->as = MX_MALLOC(sizeof(*nn->as) * arch_count);
-    MX_ASSERT(nn->as != NULL);
+// caller must hold __mx_buffers.lock; NULL when the table is full
+static __mx_buffer_bucket* __mx_buffer_bucket_for(size_t bytes, uint8_t create) {
+    size_t start = (size_t)((bytes * 0x9E3779B97F4A7C15ull) >> 40) & (MX_BUFFER_POOL_BUCKETS - 1);
+    for (size_t probe = 0; probe < MX_BUFFER_POOL_BUCKETS; ++probe) {
+        __mx_buffer_bucket* bucket = &__mx_buffers.buckets[(start + probe) & (MX_BUFFER_POOL_BUCKETS - 1)];
+        if (bucket->bytes == bytes) {
+            return bucket;
+        }
+        if (bucket->bytes == 0) {
+            if (!create) {
+                return NULL;
+            }
+            bucket->bytes = bytes;
+            return bucket;
+        }
+    }
+    return NULL;
+}
 
-    // Initialize the first layer of activation values
-    nn->as[0] = MATRIX(1, arch[0]);
+static void* __mx_buffer_alloc(size_t bytes) {
+    if (bytes < sizeof(void*) || !atomic_load_explicit(&__mx_buffers.enabled, memory_order_relaxed)) {
+        return MX_MALLOC(bytes);
+    }
+    void* buffer = NULL;
+    pthread_mutex_lock(&__mx_buffers.lock);
+    __mx_buffer_bucket* bucket = __mx_buffer_bucket_for(bytes, 0);
+    if (bucket && bucket->head) {
+        buffer = bucket->head;
+        bucket->head = *(void**)buffer;
+        bucket->count--;
+        __mx_buffers.stats.hits++;
+        __mx_buffers.stats.cached--;
+        __mx_buffers.stats.cached_bytes -= bytes;
+    } else {
+        __mx_buffers.stats.misses++;
+    }
+    pthread_mutex_unlock(&__mx_buffers.lock);
+    return buffer ? buffer : MX_MALLOC(bytes);
+}
 
-    // Initialize weights, biases, and activations for subsequent layers
-    for(size_t i = 1; i < arch_count; ++i){
-        nn->ws[i-1] = MATRIX(nn->as[i-1]->cols, arch[i]);
-        nn->bs[i-1] = MATRIX(1, arch[i]);
-        nn->as[i] = MATRIX(1, arch[i]);
+static void __mx_buffer_free(void* buffer, size_t bytes) {
+    if (!buffer) {
+        return;
+    }
+    if (bytes >= sizeof(void*) && atomic_load_explicit(&__mx_buffers.enabled, memory_order_relaxed)) {
+        pthread_mutex_lock(&__mx_buffers.lock);
+        __mx_buffer_bucket* bucket = __mx_buffer_bucket_for(bytes, 1);
+        if (bucket && bucket->count < MX_BUFFER_POOL_DEPTH) {
+            *(void**)buffer = bucket->head;
+            bucket->head = buffer;
+            bucket->count++;
+            __mx_buffers.stats.cached++;
+            __mx_buffers.stats.cached_bytes += bytes;
+            buffer = NULL;
+        }
+        pthread_mutex_unlock(&__mx_buffers.lock);
     }
+    MX_FREE(buffer);
+}
 
-    return nn;
+void mx_buffer_pool_drain(void) {
+    pthread_mutex_lock(&__mx_buffers.lock);
+    for (size_t i = 0; i < MX_BUFFER_POOL_BUCKETS; ++i) {
+        __mx_buffer_bucket* bucket = &__mx_buffers.buckets[i];
+        while (bucket->head) {
+            void* next = *(void**)bucket->head;
+            MX_FREE(bucket->head);
+            bucket->head = next;
+        }
+        bucket->bytes = 0;
+        bucket->count = 0;
+    }
+    memset(&__mx_buffers.stats, 0, sizeof(__mx_buffers.stats));
+    pthread_mutex_unlock(&__mx_buffers.lock);
+}
+
+void mx_buffer_pool_enable(uint8_t enabled) {
+    if (!enabled) {
+        atomic_store(&__mx_buffers.enabled, 0);
+        mx_buffer_pool_drain();
+        return;
+    }
+    pthread_mutex_lock(&__mx_buffers.lock);
+    if (!__mx_buffers.exit_registered) {
+        atexit(mx_buffer_pool_drain);
+        __mx_buffers.exit_registered = 1;
+    }
+    pthread_mutex_unlock(&__mx_buffers.lock);
+    atomic_store(&__mx_buffers.enabled, 1);
 }
 
+mx_buffer_pool_stats mx_buffer_pool_get_stats(void) {
+    pthread_mutex_lock(&__mx_buffers.lock);
+    mx_buffer_pool_stats stats = __mx_buffers.stats;
+    pthread_mutex_unlock(&__mx_buffers.lock);
+    return stats;
+}
 
-Matrix* mx_copy(const Matrix* src){
-    if(CHECK_MATRIX_VALIDITY(src)==-1){
+// Aligned scratch memory for packed GEMM panels. The raw pointer and its size
+// are stored in front of the aligned one.
+#define MX_ALIGN 64
+
+static void* __mx_aligned_alloc(size_t size) {
+    size_t bytes = size + MX_ALIGN + 2 * sizeof(void*);
+    void* raw = __mx_buffer_alloc(bytes);
+    if (!raw) {
         return NULL;
     }
+    uintptr_t aligned = ((uintptr_t)raw + 2 * sizeof(void*) + MX_ALIGN - 1) & ~(uintptr_t)(MX_ALIGN - 1);
+    ((void**)aligned)[-1] = raw;
+    ((size_t*)aligned)[-2] = bytes;
+    return (void*)aligned;
+}
 
-    Matrix* copy = MATRIX(src->rows, src->cols);
-    if(!copy){
-        printf("Failed to create matrix.");
-        return NULL;
+static void __mx_aligned_free(void* ptr) {
+    if (ptr) {
+        __mx_buffer_free(((void**)ptr)[-1], ((size_t*)ptr)[-2]);
     }
-    copy->col_stride = src->col_stride;
-    copy->row_stride = src->row_stride;
-    memcpy(copy->container->data, src->container->data, sizeof(float) * src->rows*src->cols);
-    return copy;
-    
 }
-Matrix* __mx_init(float* array, size_t rows, size_t cols, float init_value) {
 
-    if(!VALID_DIMENSIONS(rows, cols)){
-        printf("Invalid matrix dimensions.");
+// Arenas. Allocations are MX_ALIGN aligned bumps inside a chain of blocks; a
+// reset only rewinds the cursor, blocks past it are rewound when reached again.
+typedef struct __mx_arena_block {
+    struct __mx_arena_block* next;
+    size_t size;
+    size_t used;
+    char* data;
+} __mx_arena_block;
+
+struct mx_arena {
+    __mx_arena_block* head;
+    __mx_arena_block* current;
+    size_t block_size;
+    _Atomic(size_t*) owner;   // __mx_arena_depth of the thread it is active on, or NULL
+    size_t scopes;            // open scopes on that thread
+};
+
+// the arena scopes open on this thread, innermost last
+static _Thread_local mx_arena* __mx_arena_scopes[MX_ARENA_DEPTH];
+static _Thread_local size_t __mx_arena_depth = 0;
+
+static mx_arena* __mx_arena_active(void) {
+    return __mx_arena_depth ? __mx_arena_scopes[__mx_arena_depth - 1] : NULL;
+}
+
+static __mx_arena_block* __mx_arena_block_new(size_t size) {
+    __mx_arena_block* block = MX_MALLOC(sizeof(__mx_arena_block));
+    if (!block) {
         return NULL;
     }
-    
-    Matrix* mat = (Matrix*)MX_MALLOC(sizeof(Matrix));
-    if (!mat) {
+    block->data = __mx_aligned_alloc(size);
+    if (!block->data) {
+        MX_FREE(block);
         return NULL;
     }
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
 
-    // Pass array to init_container
-    if(array){
-        mat->container = __init_container(array, cols * rows);
-    }
-    else{
-        mat->container = __init_container(NULL, cols * rows);
+mx_arena* mx_arena_new(size_t block_size) {
+    mx_arena* arena = MX_MALLOC(sizeof(mx_arena));
+    if (!arena) {
+        return NULL;
     }
-    if (!mat->container) {
-        MX_FREE(mat);
+    arena->block_size = block_size ? block_size : MX_ARENA_BLOCK;
+    arena->head = arena->current = __mx_arena_block_new(arena->block_size);
+    atomic_init(&arena->owner, NULL);
+    arena->scopes = 0;
+    if (!arena->head) {
+        MX_FREE(arena);
         return NULL;
     }
+    return arena;
+}
 
-    mat->rows = rows;
-    mat->cols = cols;
-    mat->row_stride = cols; 
-    mat->col_stride = 1;
-
-    // TODO How about lazy matrix view by default?
-    mat->default_value = init_value;
-    mat->flags = 0;
-
-    // Initialize only if the value is non-zero and if an external array was not provided
-    if(init_value != 0 && !array){
-        for(size_t i = 0; i < mat->rows; ++i){
-            for(size_t j = 0; j < mat->cols; ++j){
-                AT(mat, i, j) = init_value;
+static void* __mx_arena_alloc(mx_arena* arena, size_t size) {
+    size = (size + MX_ALIGN - 1) & ~(size_t)(MX_ALIGN - 1);
+    __mx_arena_block* block = arena->current;
+    while (block->size - block->used < size) {
+        if (!block->next || block->next->size < size) {
+            // keep the rest of the chain for later steps, the new block goes in front of it
+            __mx_arena_block* fresh = __mx_arena_block_new(size > arena->block_size ? size : arena->block_size);
+            if (!fresh) {
+                return NULL;
             }
-        }        
+            fresh->next = block->next;
+            block->next = fresh;
+        }
+        block = block->next;
+        block->used = 0;
     }
-
-    return mat;
+    arena->current = block;
+    void* ptr = block->data + block->used;
+    block->used += size;
+    return ptr;
 }
 
-void mx_set_to_rand(Matrix* m, float min, float max)
-{
-    if(CHECK_MATRIX_VALIDITY(m) == -1){
-        return;
+// true when ptr was handed out by arena since its last reset
+static uint8_t __mx_arena_owns(const mx_arena* arena, const void* ptr) {
+    for (const __mx_arena_block* block = arena->head;; block = block->next) {
+        if ((const char*)ptr >= block->data && (const char*)ptr < block->data + block->used) {
+            return 1;
+        }
+        if (block == arena->current) {
+            return 0;
+        }
     }
-    for(size_t i = 0; i < m->rows; ++i){
-        for(size_t j = 0; j < m->cols; ++j){
-            AT(m,i,j) = ((float)rand()/(float)RAND_MAX)*(max-min)+min;
+}
 
+uint8_t mx_arena_begin(mx_arena* arena) {
+    if (!arena) {
+        return -1;
+    }
+    // the bump allocator is not thread-safe: an arena belongs to one thread at a time
+    size_t* owner = NULL;
+    if (!atomic_compare_exchange_strong(&arena->owner, &owner, &__mx_arena_depth) &&
+        owner != &__mx_arena_depth) {
+        printf("Error: arena is already active on another thread.\n");
+        return -1;
+    }
+    if (__mx_arena_depth == MX_ARENA_DEPTH) {
+        printf("Error: more than MX_ARENA_DEPTH nested arena scopes.\n");
+        if (arena->scopes == 0) {
+            atomic_store(&arena->owner, NULL);
         }
+        return -1;
     }
+    arena->scopes++;
+    __mx_arena_scopes[__mx_arena_depth++] = arena;
+    return 0;
 }
 
-void mx_nn_set_to_rand(NN* nn, float min, float max){
-    for(size_t i = 0; i < nn->count; ++i){
-        mx_set_to_rand(nn->ws[i], min, max);
-        mx_set_to_rand(nn->bs[i], min, max);
+void mx_arena_end(void) {
+    if (__mx_arena_depth == 0) {
+        return;
+    }
+    mx_arena* arena = __mx_arena_scopes[--__mx_arena_depth];
+    if (--arena->scopes == 0) {
+        atomic_store(&arena->owner, NULL);
     }
 }
 
-Matrix* mx_view(const Matrix* matrix, size_t rows, size_t cols, float default_value){
-    Matrix* view = (Matrix*)MX_MALLOC(sizeof(Matrix));
-    if (!view) {
-        printf("Failed to allocate memory for the matrix structure.");
-        return NULL;
+void mx_arena_reset(mx_arena* arena) {
+    if (arena) {
+        arena->current = arena->head;
+        arena->head->used = 0;
     }
-    if(matrix){
-        matrix->container->ref_count++;
-        view->col_stride = matrix->col_stride;
-        view->row_stride = matrix->row_stride;
-        view->cols = rows;    // corrected to use passed rows and cols
-        view->rows = cols;    // corrected to use passedf rows and cols
-        view->container = matrix->container;
-        view->default_value = default_value;
-        view->flags = 0;
+}
+
+void mx_arena_free(mx_arena* arena) {
+    if (!arena) {
+        return;
     }
-    else{
-        view->col_stride = 1;
-        view->row_stride = cols;
-        view->cols = cols;
-        view->rows = rows;
-        view->container = NULL;
-        view->default_value = default_value;
-        view->flags = 0;
-        SET_FLAG(view->flags, 0); // lazy matrix
+    __mx_arena_block* block = arena->head;
+    while (block) {
+        __mx_arena_block* next = block->next;
+        __mx_aligned_free(block->data);
+        MX_FREE(block);
+        block = next;
     }
-    return view;   
+    MX_FREE(arena);
 }
-// TODO this can be replaced with macros
-Matrix* mx_identity_new(size_t rows){
-    return mx_diagonal_new(rows, 1);
+
+// allocation hooks for matrix headers, containers and data
+static void* __mx_matrix_alloc(size_t size) {
+    mx_arena* arena = __mx_arena_active();
+    return arena ? __mx_arena_alloc(arena, size) : __mx_buffer_alloc(size);
 }
 
-Matrix* mx_diagonal_new(size_t rows, float value){
-    if(!VALID_DIMENSIONS(rows, rows)){
-        return NULL;
+static void __mx_matrix_free(void* ptr, size_t size) {
+    for (size_t i = __mx_arena_depth; i-- > 0;) {
+        if (__mx_arena_owns(__mx_arena_scopes[i], ptr)) {
+            return;
+        }
     }
-    
-    Matrix* m = MATRIX(rows, rows);
+    __mx_buffer_free(ptr, size);
+}
 
-    for(size_t i = 0; i < rows; ++i){
-        AT(m,i,i) = value;
+// SIMD kernels. Every level fills the same table of kernels working on
+// contiguous spans; the table is picked from cpuid on first use.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && \
+    (defined(__GNUC__) || defined(__clang__)) && !defined(USE_DOUBLE_PRECISION) && !defined(MX_NO_SIMD)
+#define MX_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define MX_X86_SIMD 0
+#endif
+
+#define MX_GEMM_MR 6
+#define MX_GEMM_NR 8
+#define MX_GEMM_MAX_TILE (8 * 32)
+#define MX_GEMV_ROWS 4
+
+// dst = op(a, b); alpha and beta are the scalar operands of ops that take them
+typedef void (*__mx_span_fn)(size_t n, const precision_type* a, const precision_type* b,
+                             precision_type alpha, precision_type beta, precision_type* dst);
+typedef precision_type (*__mx_span_reduce_fn)(size_t n, const precision_type* a);
+// y[r] = dot(a + r * lda, x) over n values for the first rows (at most MX_GEMV_ROWS) rows of a
+typedef void (*__mx_gemv_fn)(size_t n, size_t rows, const precision_type* a, size_t lda,
+                             const precision_type* x, precision_type* y);
+// y[i] += sum of x[c] * a[c * lda + i] over the first cols (at most MX_GEMV_ROWS) columns, for i < n
+typedef void (*__mx_gemv_cols_fn)(size_t n, size_t cols, const precision_type* a, size_t lda,
+                                  const precision_type* x, precision_type* y);
+// computes the full mr x nr tile of packed a * packed b into c (row-major, ldc = nr)
+typedef void (*__mx_gemm_kernel_fn)(size_t kc, const precision_type* a, const precision_type* b, precision_type* c);
+
+typedef struct {
+    size_t mr;
+    size_t nr;
+    __mx_gemm_kernel_fn kernel;
+} __mx_gemm_kernel;
+
+typedef struct {
+    mx_simd_level level;
+    __mx_gemm_kernel gemm;
+    __mx_span_fn ops[MX_OP_COUNT];
+    __mx_span_reduce_fn sum;
+    __mx_span_reduce_fn sum_squares;
+    __mx_gemv_fn gemv;
+    __mx_gemv_cols_fn gemv_cols;
+} __mx_kernels;
+
+// 16-byte vector type, lowered to SSE/NEON or plain scalar code by the compiler
+typedef precision_type __mx_vec __attribute__((vector_size(16)));
+#define MX_VEC_LANES (sizeof(__mx_vec) / sizeof(precision_type))
+
+static void __mx_gemm_kernel_generic(size_t kc, const precision_type* a, const precision_type* b, precision_type* c) {
+    __mx_vec acc[MX_GEMM_MR][MX_GEMM_NR / MX_VEC_LANES];
+    memset(acc, 0, sizeof(acc));
+    for (size_t p = 0; p < kc; ++p) {
+        __mx_vec bv[MX_GEMM_NR / MX_VEC_LANES];
+        memcpy(bv, b + p * MX_GEMM_NR, sizeof(bv));
+        for (size_t i = 0; i < MX_GEMM_MR; ++i) {
+            precision_type ai = a[p * MX_GEMM_MR + i];
+            for (size_t j = 0; j < MX_GEMM_NR / MX_VEC_LANES; ++j) {
+                acc[i][j] += ai * bv[j];
+            }
+        }
     }
-    return m;
+    memcpy(c, acc, sizeof(acc));
 }
 
-Matrix* mx_cross_product_alloc(const Matrix* A, const Matrix* B) {
-    // Ensure that both matrices are 3x1 vectors
-    if (A->rows != 3 || A->cols != 1 || B->rows != 3 || B->cols != 1) {
-        return NULL;  // Invalid vectors for cross product
-    }
-    
-    Matrix* result = MATRIX(3, 1);  // Replace with your function to create a 3x1 matrix
+// Scalar kernels, for builds and CPUs without SIMD support.
+#define MX_SPAN_SCALAR(name, expr)                                                          \
+static void __mx_##name##_scalar(size_t n, const precision_type* a, const precision_type* b, \
+                                 precision_type alpha, precision_type beta, precision_type* dst) { \
+    (void)b;                                                                                \
+    (void)alpha;                                                                            \
+    (void)beta;                                                                             \
+    for (size_t i = 0; i < n; ++i) {                                                        \
+        precision_type x = a[i];                                                            \
+        dst[i] = (expr);                                                                    \
+    }                                                                                       \
+}
 
-    AT(result, 0, 0) = AT(A, 1, 0) * AT(B, 2, 0) - AT(A, 2, 0) * AT(B, 1, 0);
-    AT(result, 1, 0) = AT(A, 2, 0) * AT(B, 0, 0) - AT(A, 0, 0) * AT(B, 2, 0);
-    AT(result, 2, 0) = AT(A, 0, 0) * AT(B, 1, 0) - AT(A, 1, 0) * AT(B, 0, 0);
+MX_SPAN_SCALAR(add, x + b[i])
+MX_SPAN_SCALAR(sub, x - b[i])
+MX_SPAN_SCALAR(mul, x * b[i])
+MX_SPAN_SCALAR(div, x / b[i])
+MX_SPAN_SCALAR(axpy, alpha * x + b[i])
+MX_SPAN_SCALAR(scale, x * alpha)
+MX_SPAN_SCALAR(clamp, x < alpha ? alpha : (x > beta ? beta : x))
+MX_SPAN_SCALAR(sigmoid, sigmoidf(x))
+MX_SPAN_SCALAR(tanh, tanhf(x))
+MX_SPAN_SCALAR(relu, x > 0 ? x : 0)
+MX_SPAN_SCALAR(exp, expf(x))
+MX_SPAN_SCALAR(log, logf(x))
+MX_SPAN_SCALAR(identity, x)
 
-    return result;
+static precision_type __mx_sum_scalar(size_t n, const precision_type* a) {
+    precision_type sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += a[i];
+    }
+    return sum;
 }
 
-float mx_cosine_between_two_vectors(Matrix* matrix1, Matrix* matrix2){
-    if(matrix1->rows != matrix2->rows || matrix1->cols != matrix2->cols){
-        errno = EINVAL;
-        perror("Matrices must have the same dimensionality.");
-        return -1;
+static precision_type __mx_sum_squares_scalar(size_t n, const precision_type* a) {
+    precision_type sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += a[i] * a[i];
     }
+    return sum;
+}
+
+static void __mx_gemv_scalar(size_t n, size_t rows, const precision_type* a, size_t lda,
+                             const precision_type* x, precision_type* y) {
+    for (size_t r = 0; r < rows; ++r) {
+        precision_type sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += a[r * lda + i] * x[i];
+        }
+        y[r] = sum;
+    }
+}
+
+static void __mx_gemv_cols_scalar(size_t n, size_t cols, const precision_type* a, size_t lda,
+                                  const precision_type* x, precision_type* y) {
+    for (size_t c = 0; c < cols; ++c) {
+        for (size_t i = 0; i < n; ++i) {
+            y[i] += x[c] * a[c * lda + i];
+        }
+    }
+}
+
+#define MX_SPAN_TABLE(isa) {                                                                \
+    [MX_OP_ADD] = __mx_add_##isa, [MX_OP_SUB] = __mx_sub_##isa,                             \
+    [MX_OP_MUL] = __mx_mul_##isa, [MX_OP_DIV] = __mx_div_##isa,                             \
+    [MX_OP_AXPY] = __mx_axpy_##isa, [MX_OP_SCALE] = __mx_scale_##isa,                       \
+    [MX_OP_CLAMP] = __mx_clamp_##isa, [MX_OP_SIGMOID] = __mx_sigmoid_##isa,                 \
+    [MX_OP_TANH] = __mx_tanh_##isa, [MX_OP_RELU] = __mx_relu_##isa,                         \
+    [MX_OP_EXP] = __mx_exp_##isa, [MX_OP_LOG] = __mx_log_##isa,                             \
+    [MX_OP_IDENTITY] = __mx_identity_##isa,                                                 \
+}
+
+#if MX_X86_SIMD
+// expf and logf after Cephes: range reduction by ln2 and a short polynomial.
+// exp clamps its input so 2^n stays a normal float.
+#define MX_EXP_HI 88.0f
+#define MX_EXP_LO -87.33654f
+#define MX_EXP_LOG2E 1.44269504088896341f
+#define MX_LN2_HI 0.693359375f
+#define MX_LN2_LO -2.12194440e-4f
+#define MX_SQRT_HALF 0.707106781186547524f
+
+// The vector kernels are written once with GCC/clang vector extensions and
+// compiled for each instruction set through a target attribute.
+#define MX_SPAN_VECTOR_HELPERS(isa, lanes, target)                                          \
+typedef float __mx_vf_##isa __attribute__((vector_size((lanes) * sizeof(float))));          \
+typedef int32_t __mx_vi_##isa __attribute__((vector_size((lanes) * sizeof(float))));        \
+                                                                                            \
+/* x where mask is set, y elsewhere */                                                      \
+target static inline __mx_vf_##isa __mx_select_##isa(__mx_vi_##isa mask, __mx_vf_##isa x, __mx_vf_##isa y) { \
+    return (__mx_vf_##isa)((mask & (__mx_vi_##isa)x) | (~mask & (__mx_vi_##isa)y));         \
+}                                                                                           \
+                                                                                            \
+target static inline __mx_vf_##isa __mx_vexp_##isa(__mx_vf_##isa x) {                       \
+    __mx_vf_##isa zero = {0};                                                               \
+    x = __mx_select_##isa(x > zero + MX_EXP_HI, zero + MX_EXP_HI, x);                       \
+    x = __mx_select_##isa(x < zero + MX_EXP_LO, zero + MX_EXP_LO, x);                       \
+    __mx_vf_##isa fx = x * MX_EXP_LOG2E + 0.5f;                                             \
+    __mx_vi_##isa n = __builtin_convertvector(fx, __mx_vi_##isa);                           \
+    n += __builtin_convertvector(n, __mx_vf_##isa) > fx; /* truncation to floor */          \
+    __mx_vf_##isa fn = __builtin_convertvector(n, __mx_vf_##isa);                           \
+    __mx_vf_##isa r = x - fn * MX_LN2_HI - fn * MX_LN2_LO;                                  \
+    __mx_vf_##isa p = r * 1.9875691500e-4f + 1.3981999507e-3f;                              \
+    p = p * r + 8.3334519073e-3f;                                                           \
+    p = p * r + 4.1665795894e-2f;                                                           \
+    p = p * r + 1.6666665459e-1f;                                                           \
+    p = p * r + 5.0000001201e-1f;                                                           \
+    p = p * r * r + r + 1.0f;                                                               \
+    return p * (__mx_vf_##isa)((n + 127) << 23);                                            \
+}                                                                                           \
+                                                                                            \
+target static inline __mx_vf_##isa __mx_vtanh_##isa(__mx_vf_##isa x) {                      \
+    __mx_vf_##isa zero = {0};                                                               \
+    __mx_vf_##isa t = __mx_vexp_##isa(x + x);                                               \
+    __mx_vf_##isa large = (t - 1.0f) / (t + 1.0f);                                          \
+    /* the exp form cancels near 0, use an odd polynomial there */                          \
+    __mx_vf_##isa z = x * x;                                                                \
+    __mx_vf_##isa small = z * -5.70498872745e-3f + 2.06390887954e-2f;                       \
+    small = small * z - 5.37397155531e-2f;                                                  \
+    small = small * z + 1.33314422036e-1f;                                                  \
+    small = small * z - 3.33332819422e-1f;                                                  \
+    small = small * z * x + x;                                                              \
+    return __mx_select_##isa(z < zero + 0.625f * 0.625f, small, large);                     \
+}                                                                                           \
+                                                                                            \
+target static inline __mx_vf_##isa __mx_vlog_##isa(__mx_vf_##isa x) {                       \
+    __mx_vf_##isa zero = {0};                                                               \
+    /* scale denormals into the normal range first */                                       \
+    __mx_vi_##isa denormal = x < zero + FLT_MIN;                                            \
+    __mx_vf_##isa v = __mx_select_##isa(denormal, x * 8388608.0f, x);                       \
+    __mx_vi_##isa bits = (__mx_vi_##isa)v;                                                  \
+    __mx_vi_##isa e = (bits >> 23) - 126 + (denormal & -23);                                \
+    __mx_vf_##isa m = (__mx_vf_##isa)((bits & 0x007fffff) | 0x3f000000);                    \
+    __mx_vi_##isa below = m < zero + MX_SQRT_HALF;                                          \
+    e += below;                                                                             \
+    m = m - 1.0f + __mx_select_##isa(below, m, zero);                                       \
+    __mx_vf_##isa fe = __builtin_convertvector(e, __mx_vf_##isa);                           \
+    __mx_vf_##isa z = m * m;                                                                \
+    __mx_vf_##isa p = m * 7.0376836292e-2f - 1.1514610310e-1f;                              \
+    p = p * m + 1.1676998740e-1f;                                                           \
+    p = p * m - 1.2420140846e-1f;                                                           \
+    p = p * m + 1.4249322787e-1f;                                                           \
+    p = p * m - 1.6668057665e-1f;                                                           \
+    p = p * m + 2.0000714765e-1f;                                                           \
+    p = p * m - 2.4999993993e-1f;                                                           \
+    p = p * m + 3.3333331174e-1f;                                                           \
+    __mx_vf_##isa y = p * m * z + fe * MX_LN2_LO - 0.5f * z;                                \
+    __mx_vf_##isa r = m + y + fe * MX_LN2_HI;                                               \
+    r = __mx_select_##isa(x == zero + INFINITY, x, r);                                      \
+    r = __mx_select_##isa(x == zero, zero - INFINITY, r);                                   \
+    return __mx_select_##isa((x < zero) | (x != x), zero + NAN, r);                         \
+}
+
+// x is a vector of a, y of b (zero for unary ops); va and vb are alpha and beta splats
+#define MX_SPAN_VECTOR(isa, target, name, expr)                                             \
+target static void __mx_##name##_##isa(size_t n, const float* a, const float* b,            \
+                                       float alpha, float beta, float* dst) {               \
+    typedef __mx_vf_##isa V;                                                                \
+    const size_t lanes = sizeof(V) / sizeof(float);                                         \
+    V zero = {0}, va = zero + alpha, vb = zero + beta;                                      \
+    (void)va;                                                                               \
+    (void)vb;                                                                               \
+    size_t i = 0;                                                                           \
+    for (; i + lanes <= n; i += lanes) {                                                    \
+        V x, y = zero, r;                                                                   \
+        memcpy(&x, a + i, sizeof(V));                                                       \
+        if (b) {                                                                            \
+            memcpy(&y, b + i, sizeof(V));                                                   \
+        }                                                                                   \
+        r = (expr);                                                                         \
+        memcpy(dst + i, &r, sizeof(V));                                                     \
+    }                                                                                       \
+    /* the tail runs zero padded through the same vector code, so results don't */          \
+    /* depend on where a row was split between threads */                                   \
+    if (i < n) {                                                                            \
+        V x = zero, y = zero, r;                                                            \
+        memcpy(&x, a + i, (n - i) * sizeof(float));                                         \
+        if (b) {                                                                            \
+            memcpy(&y, b + i, (n - i) * sizeof(float));                                     \
+        }                                                                                   \
+        r = (expr);                                                                         \
+        memcpy(dst + i, &r, (n - i) * sizeof(float));                                       \
+    }                                                                                       \
+}
+
+#define MX_SPAN_REDUCE_VECTOR(isa, target, name, expr)                                      \
+target static float __mx_##name##_##isa(size_t n, const float* a) {                         \
+    typedef __mx_vf_##isa V;                                                                \
+    const size_t lanes = sizeof(V) / sizeof(float);                                         \
+    V s0 = {0}, s1 = {0}, x;                                                                \
+    size_t i = 0;                                                                           \
+    for (; i + 2 * lanes <= n; i += 2 * lanes) {                                            \
+        memcpy(&x, a + i, sizeof(V));                                                       \
+        s0 += (expr);                                                                       \
+        memcpy(&x, a + i + lanes, sizeof(V));                                               \
+        s1 += (expr);                                                                       \
+    }                                                                                       \
+    s0 += s1;                                                                               \
+    float sum = 0;                                                                          \
+    for (size_t j = 0; j < lanes; ++j) {                                                    \
+        sum += s0[j];                                                                       \
+    }                                                                                       \
+    return sum + __mx_##name##_scalar(n - i, a + i);                                        \
+}
+
+// each x vector is loaded once for MX_GEMV_ROWS rows; rows are reduced independently,
+// so a row gives the same result whichever group it lands in
+#define MX_SPAN_GEMV_VECTOR(isa, target)                                                    \
+target static inline __attribute__((always_inline))                                         \
+void __mx_gemv_rows_##isa(size_t n, size_t rows, const float* a, size_t lda,                \
+                          const float* x, float* y) {                                       \
+    typedef __mx_vf_##isa V;                                                                \
+    const size_t lanes = sizeof(V) / sizeof(float);                                         \
+    V zero = {0}, s[MX_GEMV_ROWS], xv, av;                                                  \
+    for (size_t r = 0; r < rows; ++r) {                                                     \
+        s[r] = zero;                                                                        \
+    }                                                                                       \
+    size_t i = 0;                                                                           \
+    for (; i + lanes <= n; i += lanes) {                                                    \
+        memcpy(&xv, x + i, sizeof(V));                                                      \
+        for (size_t r = 0; r < rows; ++r) {                                                 \
+            memcpy(&av, a + r * lda + i, sizeof(V));                                        \
+            s[r] += av * xv;                                                                \
+        }                                                                                   \
+    }                                                                                       \
+    if (i < n) {                                                                            \
+        xv = zero;                                                                          \
+        memcpy(&xv, x + i, (n - i) * sizeof(float));                                        \
+        for (size_t r = 0; r < rows; ++r) {                                                 \
+            av = zero;                                                                      \
+            memcpy(&av, a + r * lda + i, (n - i) * sizeof(float));                          \
+            s[r] += av * xv;                                                                \
+        }                                                                                   \
+    }                                                                                       \
+    for (size_t r = 0; r < rows; ++r) {                                                     \
+        float sum = 0;                                                                      \
+        for (size_t j = 0; j < lanes; ++j) {                                                \
+            sum += s[r][j];                                                                 \
+        }                                                                                   \
+        y[r] = sum;                                                                         \
+    }                                                                                       \
+}                                                                                           \
+                                                                                            \
+target static void __mx_gemv_##isa(size_t n, size_t rows, const float* a, size_t lda,       \
+                                   const float* x, float* y) {                              \
+    if (rows == MX_GEMV_ROWS) {                                                             \
+        __mx_gemv_rows_##isa(n, MX_GEMV_ROWS, a, lda, x, y);                                \
+        return;                                                                             \
+    }                                                                                       \
+    for (size_t r = 0; r < rows; ++r) {                                                     \
+        __mx_gemv_rows_##isa(n, 1, a + r * lda, lda, x, y + r);                             \
+    }                                                                                       \
+}                                                                                           \
+                                                                                            \
+/* y is loaded and stored once for up to MX_GEMV_ROWS columns of a */                       \
+target static inline __attribute__((always_inline))                                         \
+void __mx_gemv_cols_n_##isa(size_t n, size_t cols, const float* a, size_t lda,              \
+                            const float* x, float* y) {                                     \
+    typedef __mx_vf_##isa V;                                                                \
+    const size_t lanes = sizeof(V) / sizeof(float);                                         \
+    V zero = {0}, xs[MX_GEMV_ROWS], yv, av;                                                 \
+    for (size_t c = 0; c < cols; ++c) {                                                     \
+        xs[c] = zero + x[c];                                                                \
+    }                                                                                       \
+    size_t i = 0;                                                                           \
+    for (; i + lanes <= n; i += lanes) {                                                    \
+        memcpy(&yv, y + i, sizeof(V));                                                      \
+        for (size_t c = 0; c < cols; ++c) {                                                 \
+            memcpy(&av, a + c * lda + i, sizeof(V));                                        \
+            yv += xs[c] * av;                                                               \
+        }                                                                                   \
+        memcpy(y + i, &yv, sizeof(V));                                                      \
+    }                                                                                       \
+    if (i < n) {                                                                            \
+        yv = zero;                                                                          \
+        memcpy(&yv, y + i, (n - i) * sizeof(float));                                        \
+        for (size_t c = 0; c < cols; ++c) {                                                 \
+            av = zero;                                                                      \
+            memcpy(&av, a + c * lda + i, (n - i) * sizeof(float));                          \
+            yv += xs[c] * av;                                                               \
+        }                                                                                   \
+        memcpy(y + i, &yv, (n - i) * sizeof(float));                                        \
+    }                                                                                       \
+}                                                                                           \
+                                                                                            \
+target static void __mx_gemv_cols_##isa(size_t n, size_t cols, const float* a, size_t lda,  \
+                                        const float* x, float* y) {                         \
+    if (cols == MX_GEMV_ROWS) {                                                             \
+        __mx_gemv_cols_n_##isa(n, MX_GEMV_ROWS, a, lda, x, y);                              \
+        return;                                                                             \
+    }                                                                                       \
+    for (size_t c = 0; c < cols; ++c) {                                                     \
+        __mx_gemv_cols_n_##isa(n, 1, a + c * lda, lda, x + c, y);                           \
+    }                                                                                       \
+}
+
+#define MX_SPAN_KERNELS(isa, lanes, target)                                                 \
+MX_SPAN_VECTOR_HELPERS(isa, lanes, target)                                                  \
+MX_SPAN_VECTOR(isa, target, add, x + y)                                                     \
+MX_SPAN_VECTOR(isa, target, sub, x - y)                                                     \
+MX_SPAN_VECTOR(isa, target, mul, x * y)                                                     \
+MX_SPAN_VECTOR(isa, target, div, x / y)                                                     \
+MX_SPAN_VECTOR(isa, target, axpy, va * x + y)                                               \
+MX_SPAN_VECTOR(isa, target, scale, x * va)                                                  \
+MX_SPAN_VECTOR(isa, target, clamp, __mx_select_##isa(x < va, va, __mx_select_##isa(x > vb, vb, x))) \
+MX_SPAN_VECTOR(isa, target, sigmoid, 1.0f / (1.0f + __mx_vexp_##isa(zero - x)))             \
+MX_SPAN_VECTOR(isa, target, tanh, __mx_vtanh_##isa(x))                                      \
+MX_SPAN_VECTOR(isa, target, relu, __mx_select_##isa(x > zero, x, zero))                     \
+MX_SPAN_VECTOR(isa, target, exp, __mx_vexp_##isa(x))                                        \
+MX_SPAN_VECTOR(isa, target, log, __mx_vlog_##isa(x))                                        \
+MX_SPAN_VECTOR(isa, target, identity, x)                                                    \
+MX_SPAN_REDUCE_VECTOR(isa, target, sum, x)                                                  \
+MX_SPAN_REDUCE_VECTOR(isa, target, sum_squares, x * x)                                      \
+MX_SPAN_GEMV_VECTOR(isa, target)
+
+#define MX_AVX2 __attribute__((target("avx2,fma")))
+#define MX_AVX512 __attribute__((target("avx512f")))
+
+MX_SPAN_KERNELS(sse, 4, )
+MX_SPAN_KERNELS(avx2, 8, MX_AVX2)
+MX_SPAN_KERNELS(avx512, 16, MX_AVX512)
+
+#define MX_AVX2_ROW(r) \
+    ai = _mm256_broadcast_ss(a + r); \
+    c##r##0 = _mm256_fmadd_ps(ai, b0, c##r##0); \
+    c##r##1 = _mm256_fmadd_ps(ai, b1, c##r##1)
+
+// 6 x 16 tile: 12 accumulators, 2 B vectors and a broadcast use 15 of the 16 ymm registers
+MX_AVX2 static void __mx_gemm_kernel_avx2(size_t kc, const float* a, const float* b, float* c) {
+    __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+    __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+    __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+    for (size_t p = 0; p < kc; ++p, a += 6, b += 16) {
+        __m256 b0 = _mm256_loadu_ps(b);
+        __m256 b1 = _mm256_loadu_ps(b + 8);
+        __m256 ai;
+        MX_AVX2_ROW(0);
+        MX_AVX2_ROW(1);
+        MX_AVX2_ROW(2);
+        MX_AVX2_ROW(3);
+        MX_AVX2_ROW(4);
+        MX_AVX2_ROW(5);
+    }
+    _mm256_storeu_ps(c + 0, c00);  _mm256_storeu_ps(c + 8, c01);
+    _mm256_storeu_ps(c + 16, c10); _mm256_storeu_ps(c + 24, c11);
+    _mm256_storeu_ps(c + 32, c20); _mm256_storeu_ps(c + 40, c21);
+    _mm256_storeu_ps(c + 48, c30); _mm256_storeu_ps(c + 56, c31);
+    _mm256_storeu_ps(c + 64, c40); _mm256_storeu_ps(c + 72, c41);
+    _mm256_storeu_ps(c + 80, c50); _mm256_storeu_ps(c + 88, c51);
+}
+
+
+#define MX_AVX512_ROW(r) \
+    ai = _mm512_set1_ps(a[r]); \
+    c##r##0 = _mm512_fmadd_ps(ai, b0, c##r##0); \
+    c##r##1 = _mm512_fmadd_ps(ai, b1, c##r##1)
+
+// 8 x 32 tile: 16 accumulators out of the 32 zmm registers
+MX_AVX512 static void __mx_gemm_kernel_avx512(size_t kc, const float* a, const float* b, float* c) {
+    __m512 c00 = _mm512_setzero_ps(), c01 = _mm512_setzero_ps();
+    __m512 c10 = _mm512_setzero_ps(), c11 = _mm512_setzero_ps();
+    __m512 c20 = _mm512_setzero_ps(), c21 = _mm512_setzero_ps();
+    __m512 c30 = _mm512_setzero_ps(), c31 = _mm512_setzero_ps();
+    __m512 c40 = _mm512_setzero_ps(), c41 = _mm512_setzero_ps();
+    __m512 c50 = _mm512_setzero_ps(), c51 = _mm512_setzero_ps();
+    __m512 c60 = _mm512_setzero_ps(), c61 = _mm512_setzero_ps();
+    __m512 c70 = _mm512_setzero_ps(), c71 = _mm512_setzero_ps();
+    for (size_t p = 0; p < kc; ++p, a += 8, b += 32) {
+        __m512 b0 = _mm512_loadu_ps(b);
+        __m512 b1 = _mm512_loadu_ps(b + 16);
+        __m512 ai;
+        MX_AVX512_ROW(0);
+        MX_AVX512_ROW(1);
+        MX_AVX512_ROW(2);
+        MX_AVX512_ROW(3);
+        MX_AVX512_ROW(4);
+        MX_AVX512_ROW(5);
+        MX_AVX512_ROW(6);
+        MX_AVX512_ROW(7);
+    }
+    _mm512_storeu_ps(c + 0, c00);   _mm512_storeu_ps(c + 16, c01);
+    _mm512_storeu_ps(c + 32, c10);  _mm512_storeu_ps(c + 48, c11);
+    _mm512_storeu_ps(c + 64, c20);  _mm512_storeu_ps(c + 80, c21);
+    _mm512_storeu_ps(c + 96, c30);  _mm512_storeu_ps(c + 112, c31);
+    _mm512_storeu_ps(c + 128, c40); _mm512_storeu_ps(c + 144, c41);
+    _mm512_storeu_ps(c + 160, c50); _mm512_storeu_ps(c + 176, c51);
+    _mm512_storeu_ps(c + 192, c60); _mm512_storeu_ps(c + 208, c61);
+    _mm512_storeu_ps(c + 224, c70); _mm512_storeu_ps(c + 240, c71);
+}
+
+#endif // MX_X86_SIMD
+
+static const __mx_kernels __mx_kernels_scalar = {
+    MX_SIMD_SCALAR, {MX_GEMM_MR, MX_GEMM_NR, __mx_gemm_kernel_generic},
+    MX_SPAN_TABLE(scalar), __mx_sum_scalar, __mx_sum_squares_scalar,
+    __mx_gemv_scalar, __mx_gemv_cols_scalar,
+};
+
+#if MX_X86_SIMD
+static const __mx_kernels __mx_kernels_sse = {
+    MX_SIMD_SSE, {MX_GEMM_MR, MX_GEMM_NR, __mx_gemm_kernel_generic},
+    MX_SPAN_TABLE(sse), __mx_sum_sse, __mx_sum_squares_sse,
+    __mx_gemv_sse, __mx_gemv_cols_sse,
+};
+
+static const __mx_kernels __mx_kernels_avx2 = {
+    MX_SIMD_AVX2, {6, 16, __mx_gemm_kernel_avx2},
+    MX_SPAN_TABLE(avx2), __mx_sum_avx2, __mx_sum_squares_avx2,
+    __mx_gemv_avx2, __mx_gemv_cols_avx2,
+};
+
+static const __mx_kernels __mx_kernels_avx512 = {
+    MX_SIMD_AVX512, {8, 32, __mx_gemm_kernel_avx512},
+    MX_SPAN_TABLE(avx512), __mx_sum_avx512, __mx_sum_squares_avx512,
+    __mx_gemv_avx512, __mx_gemv_cols_avx512,
+};
+#endif // MX_X86_SIMD
+
+static pthread_once_t __mx_simd_once = PTHREAD_ONCE_INIT;
+static mx_simd_level __mx_simd_detected = MX_SIMD_SCALAR;
+static _Atomic(const __mx_kernels*) __mx_active_kernels = NULL;
+
+static const __mx_kernels* __mx_kernels_for(mx_simd_level level) {
+    switch (level) {
+#if MX_X86_SIMD
+    case MX_SIMD_AVX512:
+        return &__mx_kernels_avx512;
+    case MX_SIMD_AVX2:
+        return &__mx_kernels_avx2;
+    case MX_SIMD_SSE:
+        return &__mx_kernels_sse;
+#endif
+    default:
+        return &__mx_kernels_scalar;
+    }
+}
+
+static void __mx_simd_init(void) {
+#if MX_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        __mx_simd_detected = MX_SIMD_AVX512;
+    }
+    else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        __mx_simd_detected = MX_SIMD_AVX2;
+    }
+    else {
+        __mx_simd_detected = MX_SIMD_SSE;
+    }
+#endif
+    atomic_store(&__mx_active_kernels, __mx_kernels_for(__mx_simd_detected));
+}
+
+static const __mx_kernels* __mx_simd(void) {
+    const __mx_kernels* kernels = atomic_load_explicit(&__mx_active_kernels, memory_order_acquire);
+    if (!kernels) {
+        pthread_once(&__mx_simd_once, __mx_simd_init);
+        kernels = atomic_load(&__mx_active_kernels);
+    }
+    return kernels;
+}
+
+mx_simd_level mx_get_simd_level(void) {
+    return __mx_simd()->level;
+}
+
+mx_simd_level mx_set_simd_level(mx_simd_level level) {
+    pthread_once(&__mx_simd_once, __mx_simd_init);
+    if (level > __mx_simd_detected) {
+        level = __mx_simd_detected;
+    }
+    atomic_store(&__mx_active_kernels, __mx_kernels_for(level));
+    return level;
+}
+
+void mx_free(Matrix *matrix) {
+    if (matrix)  {
+        __matrix_container* container = matrix->container;
+        // the first header of a matrix lives in its container's block and goes with it
+        uint8_t inline_header = container && container->block == (void*)matrix;
+        if(container){
+            container->ref_count--;
+            if (container->ref_count == 0) {
+                if (container->release) {
+                    container->release(container->data, container->release_ctx);
+                } else if (container->data && !container->block) {
+                    __mx_matrix_free(container->data, container->size * sizeof(*container->data));
+                }
+                if (container->block) {
+                    __mx_matrix_free(container->block, container->block_bytes);
+                } else {
+                    __mx_matrix_free(container, sizeof(*container));
+                }
+            }
+        }
+        if (!inline_header) {
+            __mx_matrix_free(matrix, sizeof(*matrix));
+        }
+    }
+}
+
+typedef struct {
+    Matrix* result;
+    const Matrix* matrix1;
+    const Matrix* matrix2;
+    float (*unary)(float);
+    float (*binary)(float, float);
+    __mx_span_fn span;      // used instead of unary/binary when set
+    precision_type alpha;
+    precision_type beta;
+} __mx_apply_args;
+
+// Elementwise task over a flat element range [start, end) split into row pieces.
+// Contiguous rows go through the span kernel in one call.
+static void __mx_apply_task(size_t start, size_t end, void* arg) {
+    const __mx_apply_args* args = arg;
+    Matrix* result = args->result;
+    const Matrix* matrix1 = args->matrix1;
+    const Matrix* matrix2 = args->matrix2;
+    uint8_t contiguous = result->col_stride == 1 && matrix1->col_stride == 1 &&
+                         (!matrix2 || matrix2->col_stride == 1);
+    size_t cols = result->cols;
+    size_t i = start / cols;
+    size_t j = start % cols;
+    for (size_t left = end - start; left > 0; ++i, j = 0) {
+        size_t stop = cols - j < left ? cols : j + left;
+        left -= stop - j;
+        if (args->span && contiguous) {
+            args->span(stop - j, &AT(matrix1, i, j), matrix2 ? &AT(matrix2, i, j) : NULL,
+                       args->alpha, args->beta, &AT(result, i, j));
+            continue;
+        }
+        for (; j < stop; ++j) {
+            if (args->span) {
+                args->span(1, &AT(matrix1, i, j), matrix2 ? &AT(matrix2, i, j) : NULL,
+                           args->alpha, args->beta, &AT(result, i, j));
+            }
+            else if (args->binary) {
+                AT(result, i, j) = args->binary(AT(matrix1, i, j), AT(matrix2, i, j));
+            }
+            else {
+                AT(result, i, j) = args->unary(AT(matrix1, i, j));
+            }
+        }
+    }
+}
+
+static uint8_t __mx_op_is_binary(mx_op op) {
+    return op == MX_OP_ADD || op == MX_OP_SUB || op == MX_OP_MUL || op == MX_OP_DIV || op == MX_OP_AXPY;
+}
+
+uint8_t mx_apply_op(Matrix* result, const Matrix* matrix1, const Matrix* matrix2, mx_op op, float alpha, float beta) {
+    if(op >= MX_OP_COUNT){
+        errno = EINVAL;
+        perror("Got an invalid op code.");
+        return -1;
+    }
+    if(CHECK_MATRIX_VALIDITY(result) == -1 || CHECK_MATRIX_VALIDITY(matrix1) == -1){
+        return -1;
+    }
+    if(result->rows != matrix1->rows || result->cols != matrix1->cols){
+        printf("Error: matrices have different dimensions.\n");
+        return -1;
+    }
+    if(__mx_op_is_binary(op)){
+        if(CHECK_MATRIX_VALIDITY(matrix2) == -1){
+            return -1;
+        }
+        if(matrix1->rows != matrix2->rows || matrix1->cols != matrix2->cols){
+            printf("Error: matrices have different dimensions.\n");
+            return -1;
+        }
+    }
+    else{
+        matrix2 = NULL;
+    }
+
+    __mx_apply_args args = {result, matrix1, matrix2, NULL, NULL, __mx_simd()->ops[op], alpha, beta};
+    mx_parallel_for(result->rows * result->cols, MX_PARALLEL_GRAIN, __mx_apply_task, &args);
+    return 0;
+}
+
+Matrix* mx_apply_op_new(const Matrix* matrix1, const Matrix* matrix2, mx_op op, float alpha, float beta) {
+    if(CHECK_MATRIX_VALIDITY(matrix1) == -1){
+        return NULL;
+    }
+    Matrix* result = MATRIX(matrix1->rows, matrix1->cols);
+    if (!result) {
+        return NULL;
+    }
+    if(mx_apply_op(result, matrix1, matrix2, op, alpha, beta) != 0){
+        mx_free(result);
+        return NULL;
+    }
+    return result;
+}
+
+void mx_apply_sigmoid(Matrix* matrix){
+    if(CHECK_MATRIX_VALIDITY(matrix) == -1){
+        errno = EINVAL;
+        perror("Got an ivalid matrix when tried to apply function.");
+        return;
+    }
+    mx_apply_op(matrix, matrix, NULL, MX_OP_SIGMOID, 0, 0);
+}
+
+void mx_apply_function(Matrix* matrix, float (*func)(float)) {
+    if(CHECK_MATRIX_VALIDITY(matrix) == -1){
+        errno = EINVAL;
+        perror("Got an ivalid matrix when tried to apply function.");
+        return;
+    }
+
+    __mx_apply_args args = {matrix, matrix, NULL, func, NULL, NULL, 0, 0};
+    mx_parallel_for(matrix->rows * matrix->cols, MX_PARALLEL_GRAIN, __mx_apply_task, &args);
+}
+
+uint8_t mx_apply_function_to_both(Matrix* matrix1,Matrix* matrix2, float (*func)(float, float)) {
+    if(CHECK_MATRIX_VALIDITY(matrix1) == -1){
+        return -1;
+    }
+    if(matrix1->rows != matrix2->rows || matrix1->cols != matrix2->cols) {
+        printf("Error: matrices have different dimensions.\n");
+        return -1;
+    }
+    __mx_apply_args args = {matrix1, matrix1, matrix2, NULL, func, NULL, 0, 0};
+    mx_parallel_for(matrix1->rows * matrix1->cols, MX_PARALLEL_GRAIN, __mx_apply_task, &args);
+    return 0;
+}
+
+Matrix* mx_apply_function_to_both_new(Matrix* matrix1,Matrix* matrix2, float (*func)(float, float)) {
+    if(CHECK_MATRIX_VALIDITY(matrix1) == -1){
+        return NULL;
+    }
+    if(matrix1->rows != matrix2->rows || matrix1->cols != matrix2->cols) {
+        printf("Error: matrices have different dimensions.\n");
+        return NULL;
+    }
+    Matrix* result = MATRIX(matrix1->rows, matrix1->cols);
+    if (!result) {
+        return NULL;
+    }
+    __mx_apply_args args = {result, matrix1, matrix2, NULL, func, NULL, 0, 0};
+    mx_parallel_for(matrix1->rows * matrix1->cols, MX_PARALLEL_GRAIN, __mx_apply_task, &args);
+    return result;
+}
+
+__matrix_container* __init_container(float* array, size_t size) {
+    if(size == 0){
+        return NULL;
+    }
+    
+    __matrix_container* container = __mx_matrix_alloc(sizeof(__matrix_container));
+    if (!container) {
+        return NULL;
+    }
+
+    container->ref_count = 1;
+
+    container->size = size;
+    container->release = NULL;
+    container->release_ctx = NULL;
+    container->block = NULL;
+    container->block_bytes = 0;
+
+    // Allocate from the active arena, or the heap outside of one
+    container->data = size <= SIZE_MAX / sizeof(*container->data) ?
+                      __mx_matrix_alloc(size * sizeof(*container->data)) : NULL;
+    
+    if (!container->data) {
+        __mx_matrix_free(container, sizeof(*container));
+        return NULL;
+    }
+
+    // If an external array is provided, copy the data over
+    if (array) {
+        memcpy(container->data, array, size * sizeof(*container->data));
+    }
+    else {
+        memset(container->data, 0, size * sizeof(*container->data));
+    }
+
+    return container;
+}
+
+NN* __mx_nn_alloc(size_t* arch, size_t arch_count){
+    
+    // Validate the input parameters
+    if (arch == NULL || arch_count == 0) {
+        // Some error handling mechanism should be in place, like returning a null NN or aborting.
+        // For simplicity, I'm using a dummy assert here.
+        MX_ASSERT(0); 
+    }
+    
+    NN* nn = (NN*)MX_MALLOC(sizeof(NN));
+    nn->count = arch_count - 1;
+
+    // Allocate memory for weight matrices
+    nn->ws = MX_MALLOC(sizeof(*nn->ws) * nn->count);
+    MX_ASSERT(nn->ws != NULL);
+
+    // Allocate memory for bias vectors
+    nn->bs = MX_MALLOC(sizeof(*nn->bs) * nn->count);
+    MX_ASSERT(nn->bs != NULL);
+
+    // Allocate memory for activation values
+    nn->as = MX_MALLOC(sizeof(*nn->as) * arch_count);
+    MX_ASSERT(nn->as != NULL);
+
+    // Initialize the first layer of activation values
+    nn->as[0] = MATRIX(1, arch[0]);
+
+    // Initialize weights, biases, and activations for subsequent layers
+    for(size_t i = 1; i < arch_count; ++i){
+        nn->ws[i-1] = MATRIX(nn->as[i-1]->cols, arch[i]);
+        nn->bs[i-1] = MATRIX(1, arch[i]);
+        nn->as[i] = MATRIX(1, arch[i]);
+    }
+
+    return nn;
+}
+
+
+// true when the strides address exactly rows x cols consecutive elements
+static uint8_t __mx_compact(const Matrix* matrix) {
+    if (matrix->row_stride == 0 || matrix->col_stride == 0) {
+        return 0;
+    }
+    size_t span = (matrix->rows - 1) * matrix->row_stride + (matrix->cols - 1) * matrix->col_stride + 1;
+    return span == matrix->rows * matrix->cols && matrix->offset + span <= matrix->container->size &&
+           ((matrix->col_stride == 1 && matrix->row_stride == matrix->cols) ||
+            (matrix->row_stride == 1 && matrix->col_stride == matrix->rows));
+}
+
+Matrix* mx_copy(const Matrix* src){
+    if(CHECK_MATRIX_VALIDITY(src)==-1){
+        return NULL;
+    }
+
+    Matrix* copy = MATRIX(src->rows, src->cols);
+    if(!copy){
+        printf("Failed to create matrix.");
+        return NULL;
+    }
+    // dense and transposed layouts are copied as they are, anything else (slices) is packed
+    if(__mx_compact(src)){
+        copy->col_stride = src->col_stride;
+        copy->row_stride = src->row_stride;
+        memcpy(copy->container->data, &AT(src, 0, 0), sizeof(precision_type) * src->rows*src->cols);
+        return copy;
+    }
+    for(size_t i = 0; i < src->rows; ++i){
+        for(size_t j = 0; j < src->cols; ++j){
+            AT(copy, i, j) = AT(src, i, j);
+        }
+    }
+    return copy;
+}
+// Header, container and data in one allocation, the data at the next MX_ALIGN
+// boundary. The header stays valid until the container's last reference is freed.
+static Matrix* __mx_alloc_inline(size_t elements) {
+    size_t head = sizeof(Matrix) + sizeof(__matrix_container);
+    if (elements > (SIZE_MAX - head - MX_ALIGN) / sizeof(precision_type)) {
+        return NULL;
+    }
+    size_t bytes = head + (elements ? MX_ALIGN - 1 + elements * sizeof(precision_type) : 0);
+    char* block = __mx_matrix_alloc(bytes);
+    if (!block) {
+        return NULL;
+    }
+    Matrix* mat = (Matrix*)block;
+    __matrix_container* container = (__matrix_container*)(block + sizeof(Matrix));
+    container->ref_count = 1;
+    container->size = elements;
+    container->data = elements ? (precision_type*)(((uintptr_t)(block + head) + MX_ALIGN - 1) & ~(uintptr_t)(MX_ALIGN - 1)) : NULL;
+    container->release = NULL;
+    container->release_ctx = NULL;
+    container->block = block;
+    container->block_bytes = bytes;
+    mat->container = container;
+    mat->flags = 0;
+    mat->offset = 0;
+    mat->col_stride = 1;
+    mat->default_value = 0;
+    return mat;
+}
+
+static Matrix* __mx_new(const float* array, size_t rows, size_t cols, size_t row_stride, float init_value) {
+    if(!VALID_DIMENSIONS(rows, cols)){
+        printf("Invalid matrix dimensions.");
+        return NULL;
+    }
+    if(rows > SIZE_MAX / row_stride){
+        return NULL;
+    }
+    Matrix* mat = __mx_alloc_inline(rows * row_stride);
+    if (!mat) {
+        return NULL;
+    }
+    mat->rows = rows;
+    mat->cols = cols;
+    mat->row_stride = row_stride;
+
+    // TODO How about lazy matrix view by default?
+    mat->default_value = init_value;
+
+    precision_type* data = mat->container->data;
+    memset(data, 0, rows * row_stride * sizeof(*data));
+    if(array){
+        for(size_t i = 0; i < rows; ++i){
+            memcpy(data + i * row_stride, array + i * cols, cols * sizeof(*data));
+        }
+    }
+    // Initialize only if the value is non-zero and if an external array was not provided
+    else if(init_value != 0){
+        for(size_t i = 0; i < mat->rows; ++i){
+            for(size_t j = 0; j < mat->cols; ++j){
+                AT(mat, i, j) = init_value;
+            }
+        }        
+    }
+    return mat;
+}
+
+Matrix* __mx_init(float* array, size_t rows, size_t cols, float init_value) {
+    return __mx_new(array, rows, cols, cols, init_value);
+}
+
+Matrix* mx_padded_new(size_t rows, size_t cols) {
+    size_t lanes = MX_ALIGN / sizeof(precision_type);
+    if(cols > SIZE_MAX - lanes){
+        return NULL;
+    }
+    return __mx_new(NULL, rows, cols, (cols + lanes - 1) / lanes * lanes, 0);
+}
+
+// release used for borrowed buffers: the caller keeps ownership
+static void __mx_borrowed_release(precision_type* data, void* ctx) {
+    (void)data;
+    (void)ctx;
+}
+
+Matrix* mx_wrap(precision_type* data, size_t rows, size_t cols, void (*release)(precision_type* data, void* ctx), void* ctx) {
+    if(!data || !VALID_DIMENSIONS(rows, cols)){
+        errno = EINVAL;
+        perror("ERROR when 'mx_wrap'");
+        return NULL;
+    }
+    Matrix* mat = __mx_alloc_inline(0);
+    if(!mat){
+        return NULL;
+    }
+    mat->container->size = rows * cols;
+    mat->container->data = data;
+    mat->container->release = release ? release : __mx_borrowed_release;
+    mat->container->release_ctx = ctx;
+
+    mat->rows = rows;
+    mat->cols = cols;
+    mat->row_stride = cols;
+    return mat;
+}
+
+void mx_set_to_rand(Matrix* m, float min, float max)
+{
+    if(CHECK_MATRIX_VALIDITY(m) == -1){
+        return;
+    }
+    for(size_t i = 0; i < m->rows; ++i){
+        for(size_t j = 0; j < m->cols; ++j){
+            AT(m,i,j) = ((float)rand()/(float)RAND_MAX)*(max-min)+min;
+
+        }
+    }
+}
+
+void mx_nn_set_to_rand(NN* nn, float min, float max){
+    for(size_t i = 0; i < nn->count; ++i){
+        mx_set_to_rand(nn->ws[i], min, max);
+        mx_set_to_rand(nn->bs[i], min, max);
+    }
+}
+
+Matrix* mx_view(const Matrix* matrix, size_t rows, size_t cols, float default_value){
+    Matrix* view = (Matrix*)__mx_matrix_alloc(sizeof(Matrix));
+    if (!view) {
+        printf("Failed to allocate memory for the matrix structure.");
+        return NULL;
+    }
+    if(matrix){
+        matrix->container->ref_count++;
+        view->col_stride = matrix->col_stride;
+        view->row_stride = matrix->row_stride;
+        view->offset = matrix->offset;
+        view->cols = rows;    // corrected to use passed rows and cols
+        view->rows = cols;    // corrected to use passedf rows and cols
+        view->container = matrix->container;
+        view->default_value = default_value;
+        view->flags = 0;
+    }
+    else{
+        view->col_stride = 1;
+        view->row_stride = cols;
+        view->offset = 0;
+        view->cols = cols;
+        view->rows = rows;
+        view->container = NULL;
+        view->default_value = default_value;
+        view->flags = 0;
+        SET_FLAG(view->flags, 0); // lazy matrix
+    }
+    return view;   
+}
+// TODO this can be replaced with macros
+Matrix* mx_identity_new(size_t rows){
+    return mx_diagonal_new(rows, 1);
+}
+
+Matrix* mx_diagonal_new(size_t rows, float value){
+    if(!VALID_DIMENSIONS(rows, rows)){
+        return NULL;
+    }
+    
+    Matrix* m = MATRIX(rows, rows);
+
+    for(size_t i = 0; i < rows; ++i){
+        AT(m,i,i) = value;
+    }
+    return m;
+}
+
+Matrix* mx_cross_product_alloc(const Matrix* A, const Matrix* B) {
+    // Ensure that both matrices are 3x1 vectors
+    if (A->rows != 3 || A->cols != 1 || B->rows != 3 || B->cols != 1) {
+        return NULL;  // Invalid vectors for cross product
+    }
+    
+    mx_vec3 a, b;
+    if (mx_vec3_load(&a, A) == (uint8_t)-1 || mx_vec3_load(&b, B) == (uint8_t)-1) {
+        return NULL;
+    }
+    mx_vec3 cross = mx_vec3_cross(a, b);
+    Matrix* result = MATRIX(3, 1);
+    if (result) {
+        mx_vec3_store(&cross, result);
+    }
+    return result;
+}
+
+float mx_cosine_between_two_vectors(Matrix* matrix1, Matrix* matrix2){
+    if(matrix1->rows != matrix2->rows || matrix1->cols != matrix2->cols){
+        errno = EINVAL;
+        perror("Matrices must have the same dimensionality.");
+        return -1;
+    }
+
+    Matrix* product;
+    if(matrix1->rows == 1 && matrix2->rows == 1){
+        Matrix* mx2_transposed = TRANSPOSE_VIEW(matrix2);
+        product = SAFE_DOT(matrix1, mx2_transposed);
+        mx_free(mx2_transposed);
+    }
+    else if( matrix1->cols == 1 && matrix2->cols ==1){
+        Matrix* mx1_transposed = TRANSPOSE_VIEW(matrix1);
+        product = SAFE_DOT(mx1_transposed, matrix2);
+        mx_free(mx1_transposed);
+    }
+    else{
+        errno = EINVAL;
+        perror("Both matrices must be vectors.");
+        return -1;
+    }
+
+    float length1 = mx_length(matrix1);
+    float length2 = mx_length(matrix2);
+
+    if(length1 == 0 || length2 == 0) {
+        perror("One or both of the vectors have zero length.");
+        mx_free(product);
+        return -1;
+    }
+
+    float result = AT(product,0,0) / (length1 * length2);
+    mx_free(product);
+    return result;
+}
+
+Matrix* mx_perpendicular_new(const Matrix* matrix){
+    // Check if matrix is valid
+    if (CHECK_MATRIX_VALIDITY(matrix) == -1) {
+        errno = EINVAL;
+        perror("Error in 'mx_unit_vector_from'. Invalid matrix for this operation");
+        return NULL;
+    }
+    // Check if matrix is in vector form
+    if (matrix->cols != 1 && matrix->rows != 1) {
+        errno = EINVAL;
+        perror("Matrix should be in vector form in order to calculate unit vector");
+        return NULL;    
+    }
+    Matrix* m_copy = MATRIX_COPY(matrix);
+    if(m_copy->rows == 2 || m_copy->cols == 2){
+        swap(&AT(m_copy,0,0), &AT(m_copy,0,1));
+        AT(m_copy,0,0) *= -1;
+        return m_copy;
+    }
+    if(m_copy->rows == 3 || m_copy->cols == 3){
+        // Base vectors
+        Matrix* x_base = MATRIX(1, 3);
+        AT(x_base, 0, 0) = 1; AT(x_base, 0, 1) = 0; AT(x_base, 0, 2) = 0;
+
+        Matrix* y_base = MATRIX(1, 3);
+        AT(y_base, 0, 0) = 0; AT(y_base, 0, 1) = 1; AT(y_base, 0, 2) = 0;
+
+        // If vec is not parallel to x_base, use x_base
+        Matrix* base_to_use = x_base;
+        if (fabs(AT(m_copy, 0, 0)) > 0.99) {  // Here 0.99 is an arbitrary threshold, adjust as needed
+            base_to_use = y_base;  // Use y_base if vec is nearly parallel to x_base
+        }
+
+        Matrix* perpendicular = mx_cross_product_alloc(m_copy, base_to_use);
+        mx_free(m_copy);
+        mx_free(y_base);
+        mx_free(x_base);
+        return perpendicular;
+    }
+    errno = EINVAL;
+    perror("ERROR: infinite many perpendiculars for more then 3 dimensional vector");
+    return NULL;
+
+}
+
+Matrix* mx_unit_vector_from(const Matrix* matrix) {
+    // Check if matrix is valid
+    if (CHECK_MATRIX_VALIDITY(matrix) == -1) {
+        errno = EINVAL;
+        perror("Error in 'mx_unit_vector_from'. Invalid matrix for this operation");
+        return NULL;
+    }
+
+    // Check if matrix is in vector form
+    if (matrix->cols != 1 && matrix->rows != 1) {
+        errno = EINVAL;
+        perror("Matrix should be in vector form in order to calculate unit vector");
+        return NULL;    
+    }
+
+    Matrix* result = MATRIX_COPY(matrix);
+    float length = mx_length(matrix);
+
+    // Check if length is close to zero
+    if (fabs(length) < 1e-6) {
+        errno = EINVAL;
+        perror("Error in 'mx_unit_vector_from'. Vector length is too close to zero");
+        mx_free(result);  // MX_FREE the allocated matrix before returning
+        return NULL;
+    }
+
+    for (size_t i = 0; i < result->rows; ++i) {
+        for (size_t j = 0; j < result->cols; ++j) {
+            AT(result,i,j) /= length;
+        }
+    }
+
+    return result;
+}
+
+
+uint8_t mx_equal(Matrix* matrix1, Matrix* matrix2){
+    if(!VALID_MATRIX(matrix1) || !VALID_MATRIX(matrix2)) {
+        perror("Invalid matrix dimensions.");
+        return 0;
+    }
+    if(matrix1->rows != matrix2->rows || matrix1->cols != matrix2->cols){
+        return 0;
+    }
+    for(size_t i = 0; i < matrix1->rows; ++i){
+        for(size_t j =0; j<matrix1->cols; ++j){
+            if(AT(matrix1,i,j) != AT(matrix2,i,j)){
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+Matrix* mx_transpose(Matrix* matrix, uint8_t flags){
+    Matrix* mx_transposed;
+    if(CHECK_MATRIX_VALIDITY(matrix) == -1){
+        return NULL;
+    }
+
+    if(CHECK_FLAG(flags,0) == 1){
+        size_t rows = matrix->rows;
+        matrix->rows = matrix->cols;
+        matrix->cols = rows;
+        
+        size_t row_stride = matrix->row_stride;    
+        matrix->row_stride = matrix->col_stride;      
+        matrix->col_stride = row_stride;
+        return matrix; 
+
+    }
+    else if(CHECK_FLAG(flags,2) == 1){
+        mx_transposed = MATRIX_COPY(matrix);
+        if(!mx_transposed){
+            return NULL;
+        }
+    }
+    else {
+        mx_transposed = MATRIX_VIEW(matrix);
+        if(!mx_transposed){
+            return NULL;
+        }
+    }
+
+    size_t row_stride = mx_transposed->row_stride;
+    mx_transposed->rows = matrix->cols;
+    mx_transposed->cols = matrix->rows;
+    mx_transposed->row_stride = mx_transposed->col_stride;
+    mx_transposed->col_stride = row_stride;
+
+    return mx_transposed;
+}
+
+Matrix* mx_arrange_alloc(size_t rows, size_t cols, float start_arrange) {
+    Matrix* matrix = MATRIX(rows, cols);
+    if (!matrix) {
+        printf("Failed to allocate memory for the matrix.\n");
+        return NULL;
+    }
+
+    for(size_t i=0; i< matrix->rows; ++i){
+        for(size_t j=0; j< matrix->cols; ++j, start_arrange++){
+            AT(matrix, i, j) = start_arrange;
+        }
+    }
+
+    return matrix;
+}
+
+Matrix* mx_scale(Matrix* matrix, float scalar) {
+    if(CHECK_MATRIX_VALIDITY(matrix) == -1){
+        return NULL;
+    }
+    Matrix* result = MATRIX(matrix->rows, matrix->cols);
+    if (!result) {
+        printf("Failed to allocate memory for the scaled matrix.\n");
+        return NULL;
+    }
+
+    mx_apply_op(result, matrix, NULL, MX_OP_SCALE, scalar, 0);
+
+    return result;
+}
+
+Matrix* mx_rand_alloc(size_t rows, size_t cols) {
+    Matrix* matrix = MATRIX(rows, cols);
+    if (!matrix) {
+        printf("Failed to allocate memory for the matrix.\n");
+        return NULL;
+    }
+
+    for(size_t i = 0; i < matrix->rows; ++i) {
+        for(size_t j = 0; j < matrix->cols; ++j) {
+            float value = (float)((double)rand() / RAND_MAX);
+            AT(matrix, i, j) = value;
+        }
+    }
+
+    return matrix;
+}
+
+// Reductions keep one partial per chunk and add them up in chunk order, so the
+// result does not depend on which thread ran which chunk.
+#define MX_MAX_PARTIALS 256
+
+typedef struct {
+    const Matrix* matrix;
+    precision_type* partials;
+    size_t grain;
+    uint8_t squares;
+} __mx_reduce_args;
+
+static void __mx_reduce_task(size_t start, size_t end, void* arg) {
+    const __mx_reduce_args* args = arg;
+    const Matrix* matrix = args->matrix;
+    const __mx_kernels* kernels = __mx_simd();
+    __mx_span_reduce_fn span = args->squares ? kernels->sum_squares : kernels->sum;
+    size_t cols = matrix->cols;
+    // a serial run gets the whole range, so walk it chunk by chunk all the same
+    for (; start < end; start += args->grain) {
+        size_t i = start / cols;
+        size_t j = start % cols;
+        size_t left = end - start < args->grain ? end - start : args->grain;
+        precision_type sum = 0;
+        for (; left > 0; ++i, j = 0) {
+            size_t stop = cols - j < left ? cols : j + left;
+            left -= stop - j;
+            if (matrix->col_stride == 1) {
+                sum += span(stop - j, &AT(matrix, i, j));
+                continue;
+            }
+            for (; j < stop; ++j) {
+                precision_type element = AT(matrix, i, j);
+                sum += args->squares ? element * element : element;
+            }
+        }
+        args->partials[start / args->grain] = sum;
+    }
+}
+
+static precision_type __mx_reduce(const Matrix* matrix, uint8_t squares) {
+    precision_type partials[MX_MAX_PARTIALS] = {0};
+    size_t count = matrix->rows * matrix->cols;
+    size_t grain = (count + MX_MAX_PARTIALS - 1) / MX_MAX_PARTIALS;
+    if (grain < MX_PARALLEL_GRAIN) {
+        grain = MX_PARALLEL_GRAIN;
+    }
+    __mx_reduce_args args = {matrix, partials, grain, squares};
+    mx_parallel_for(count, grain, __mx_reduce_task, &args);
+
+    precision_type total = 0;
+    for (size_t i = 0; i < MX_MAX_PARTIALS; ++i) {
+        total += partials[i];
+    }
+    return total;
+}
+
+float mx_length(const Matrix* matrix) {
+    if (matrix == NULL) {
+        errno = EINVAL;
+        perror("ERROR when 'mx_length': Matrix is NULL.\n");
+        return -1;
+    }
+
+    // sum of squares of elements
+    return sqrt(__mx_reduce(matrix, 1));
+}
+// GEMM engine: C = alpha * A * B + beta * C over arbitrary (row, col) strides.
+// B is packed into KC x NC panels, A into MC x KC blocks, both laid out as
+// micro-panels so the microkernel streams them with unit stride.
+// Packing picks its loop order from the strides so that the source is always
+// read along its unit stride: row-major and transposed (TRANSPOSE_VIEW) operands
+// cost the same, any other layout takes the generic gather.
+
+// packs an mc x kc block of A into row panels of height mr, zero padded
+static void __mx_pack_a(size_t mc, size_t kc, const precision_type* a, size_t rsa, size_t csa,
+                        size_t mr, precision_type* dst) {
+    for (size_t ir = 0; ir < mc; ir += mr, dst += mr * kc) {
+        size_t rows = mc - ir < mr ? mc - ir : mr;
+        const precision_type* panel = a + ir * rsa;
+        if (csa == 1) {
+            // rows of A are contiguous, transposed into the panel in steps of 8 values
+            for (size_t p0 = 0; p0 < kc; p0 += 8) {
+                size_t steps = kc - p0 < 8 ? kc - p0 : 8;
+                for (size_t i = 0; i < rows; ++i) {
+                    const precision_type* src = panel + i * rsa + p0;
+                    for (size_t p = 0; p < steps; ++p) {
+                        dst[(p0 + p) * mr + i] = src[p];
+                    }
+                }
+            }
+        } else if (rsa == 1) {
+            // columns of A are contiguous, which is the panel layout already
+            for (size_t p = 0; p < kc; ++p) {
+                memcpy(dst + p * mr, panel + p * csa, rows * sizeof(*dst));
+            }
+        } else {
+            for (size_t p = 0; p < kc; ++p) {
+                for (size_t i = 0; i < rows; ++i) {
+                    dst[p * mr + i] = panel[i * rsa + p * csa];
+                }
+            }
+        }
+        for (size_t p = 0; p < kc && rows < mr; ++p) {
+            memset(dst + p * mr + rows, 0, (mr - rows) * sizeof(*dst));
+        }
+    }
+}
+
+// packs a kc x nc panel of B into column panels of width nr, zero padded
+static void __mx_pack_b(size_t kc, size_t nc, const precision_type* b, size_t rsb, size_t csb,
+                        size_t nr, precision_type* dst) {
+    for (size_t jr = 0; jr < nc; jr += nr, dst += nr * kc) {
+        size_t cols = nc - jr < nr ? nc - jr : nr;
+        const precision_type* panel = b + jr * csb;
+        if (csb == 1) {
+            for (size_t p = 0; p < kc; ++p) {
+                memcpy(dst + p * nr, panel + p * rsb, cols * sizeof(*dst));
+            }
+        } else if (rsb == 1) {
+            // B is a transposed view: its columns are contiguous, transposed in
+            // steps of 8 values so the destination rows stay in L1
+            for (size_t p0 = 0; p0 < kc; p0 += 8) {
+                size_t steps = kc - p0 < 8 ? kc - p0 : 8;
+                for (size_t j = 0; j < cols; ++j) {
+                    const precision_type* src = panel + j * csb + p0;
+                    for (size_t p = 0; p < steps; ++p) {
+                        dst[(p0 + p) * nr + j] = src[p];
+                    }
+                }
+            }
+        } else {
+            for (size_t p = 0; p < kc; ++p) {
+                for (size_t j = 0; j < cols; ++j) {
+                    dst[p * nr + j] = panel[p * rsb + j * csb];
+                }
+            }
+        }
+        for (size_t p = 0; p < kc && cols < nr; ++p) {
+            memset(dst + p * nr + cols, 0, (nr - cols) * sizeof(*dst));
+        }
+    }
+}
+
+// Optional work done on finished values of C before they are stored: a bias
+// broadcast over the rows, then an elementwise activation.
+typedef struct {
+    const precision_type* bias;     // bias[j * bias_stride] is added to column j, NULL for none
+    size_t bias_stride;
+    __mx_span_fn activation;        // NULL for none
+} __mx_gemm_epilogue;
+
+// applies the epilogue to n contiguous values of one row, starting at column col
+static void __mx_epilogue_apply(const __mx_gemm_epilogue* ep, precision_type* values, size_t n, size_t col) {
+    if (ep->bias) {
+        for (size_t j = 0; j < n; ++j) {
+            values[j] += ep->bias[(col + j) * ep->bias_stride];
+        }
+    }
+    if (ep->activation) {
+        ep->activation(n, values, NULL, 0, 0, values);
+    }
+}
+
+static void __mx_gemm_small(size_t m, size_t n, size_t k, precision_type alpha,
+                            const precision_type* a, size_t rsa, size_t csa,
+                            const precision_type* b, size_t rsb, size_t csb,
+                            precision_type beta, precision_type* c, size_t rsc, size_t csc,
+                            const __mx_gemm_epilogue* ep) {
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            // Loop unrolling for innermost loop
+            size_t p;
+            precision_type sum = 0;
+            for (p = 0; p + 3 < k; p += 4) {
+                sum += a[i * rsa + p * csa] * b[p * rsb + j * csb]
+                     + a[i * rsa + (p + 1) * csa] * b[(p + 1) * rsb + j * csb]
+                     + a[i * rsa + (p + 2) * csa] * b[(p + 2) * rsb + j * csb]
+                     + a[i * rsa + (p + 3) * csa] * b[(p + 3) * rsb + j * csb];
+            }
+            for (; p < k; ++p) {
+                sum += a[i * rsa + p * csa] * b[p * rsb + j * csb];
+            }
+            precision_type* dst = &c[i * rsc + j * csc];
+            *dst = beta == 0 ? alpha * sum : alpha * sum + beta * *dst;
+        }
+        // the row was just written and is still in L1
+        if (ep && csc == 1) {
+            __mx_epilogue_apply(ep, &c[i * rsc], n, 0);
+        }
+        else if (ep) {
+            for (size_t j = 0; j < n; ++j) {
+                __mx_epilogue_apply(ep, &c[i * rsc + j * csc], 1, j);
+            }
+        }
+    }
+}
+
+static void __mx_gemm(size_t m, size_t n, size_t k, precision_type alpha,
+                      const precision_type* a, size_t rsa, size_t csa,
+                      const precision_type* b, size_t rsb, size_t csb,
+                      precision_type beta, precision_type* c, size_t rsc, size_t csc,
+                      const __mx_gemm_epilogue* ep) {
+    if (m == 0 || n == 0) {
+        return;
+    }
+    if (k == 0 || m * n * k <= MX_GEMM_SMALL) {
+        __mx_gemm_small(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, rsc, csc, ep);
+        return;
+    }
+
+    const __mx_gemm_kernel* kern = &__mx_simd()->gemm;
+    __mx_span_fn const* ops = __mx_simd()->ops;
+    size_t mr = kern->mr;
+    size_t nr = kern->nr;
+    size_t mc_max = MX_GEMM_MC < mr ? mr : MX_GEMM_MC - MX_GEMM_MC % mr;
+    size_t kc_max = k < MX_GEMM_KC ? k : MX_GEMM_KC;
+    size_t nc_max = n < MX_GEMM_NC ? n : MX_GEMM_NC;
+    size_t mc_cap = m < mc_max ? m : mc_max;
+
+    precision_type* pack_a = __mx_aligned_alloc(sizeof(precision_type) * kc_max * (mc_cap + mr));
+    precision_type* pack_b = __mx_aligned_alloc(sizeof(precision_type) * kc_max * (nc_max + nr));
+    if (!pack_a || !pack_b) {
+        __mx_aligned_free(pack_a);
+        __mx_aligned_free(pack_b);
+        __mx_gemm_small(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, rsc, csc, ep);
+        return;
+    }
+
+    _Alignas(MX_ALIGN) precision_type tile[MX_GEMM_MAX_TILE];
+    for (size_t jc = 0; jc < n; jc += nc_max) {
+        size_t nc = n - jc < nc_max ? n - jc : nc_max;
+        for (size_t pc = 0; pc < k; pc += kc_max) {
+            size_t kc = k - pc < kc_max ? k - pc : kc_max;
+            // beta only applies to the first rank-kc update, later ones accumulate
+            precision_type block_beta = pc == 0 ? beta : 1;
+            // the epilogue runs on the tile of the last update, before it leaves L1
+            const __mx_gemm_epilogue* block_ep = pc + kc >= k ? ep : NULL;
+            __mx_pack_b(kc, nc, b + pc * rsb + jc * csb, rsb, csb, nr, pack_b);
+
+            for (size_t ic = 0; ic < m; ic += mc_max) {
+                size_t mc = m - ic < mc_max ? m - ic : mc_max;
+                __mx_pack_a(mc, kc, a + ic * rsa + pc * csa, rsa, csa, mr, pack_a);
+
+                for (size_t jr = 0; jr < nc; jr += nr) {
+                    size_t cols = nc - jr < nr ? nc - jr : nr;
+                    for (size_t ir = 0; ir < mc; ir += mr) {
+                        size_t rows = mc - ir < mr ? mc - ir : mr;
+                        kern->kernel(kc, pack_a + ir * kc, pack_b + jr * kc, tile);
+
+                        precision_type* cc = c + (ic + ir) * rsc + (jc + jr) * csc;
+                        for (size_t i = 0; i < rows; ++i) {
+                            precision_type* row = tile + i * nr;
+                            precision_type* dst = cc + i * rsc;
+                            if (csc == 1) {
+                                // short k makes this as costly as the microkernel, keep it vectorized
+                                if (block_beta == 0) {
+                                    ops[MX_OP_SCALE](cols, row, NULL, alpha, 0, row);
+                                }
+                                else if (block_beta == 1) {
+                                    ops[MX_OP_AXPY](cols, row, dst, alpha, 0, row);
+                                }
+                                else {
+                                    ops[MX_OP_SCALE](cols, row, NULL, alpha, 0, row);
+                                    ops[MX_OP_AXPY](cols, dst, row, block_beta, 0, row);
+                                }
+                            }
+                            else {
+                                for (size_t j = 0; j < cols; ++j) {
+                                    precision_type value = alpha * row[j];
+                                    row[j] = block_beta == 0 ? value : value + block_beta * dst[j * csc];
+                                }
+                            }
+                            if (block_ep) {
+                                __mx_epilogue_apply(block_ep, row, cols, jc + jr);
+                            }
+                            if (csc == 1) {
+                                memcpy(dst, row, cols * sizeof(*row));
+                            }
+                            else {
+                                for (size_t j = 0; j < cols; ++j) {
+                                    dst[j * csc] = row[j];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    __mx_aligned_free(pack_a);
+    __mx_aligned_free(pack_b);
+}
+
+// y = alpha * A x + beta * y, A is m x k with a unit stride along one of its dimensions
+typedef struct {
+    size_t m;
+    size_t k;
+    precision_type alpha;
+    const precision_type* a;
+    size_t rsa;
+    size_t csa;
+    const precision_type* x;        // contiguous when csa == 1
+    size_t incx;
+    precision_type beta;
+    precision_type* y;
+    size_t incy;
+    const __mx_gemm_epilogue* ep;
+    uint8_t ep_cols;                // y runs along the columns of the result, otherwise down column 0
+} __mx_gemv_args;
+
+// pool task: [start, end) counts blocks of MX_GEMV_BLOCK rows of A
+static void __mx_gemv_task(size_t start, size_t end, void* arg) {
+    const __mx_gemv_args* g = arg;
+    const __mx_kernels* kernels = __mx_simd();
+    _Alignas(MX_ALIGN) precision_type acc[MX_GEMV_BLOCK];
+
+    for (size_t block = start; block < end; ++block) {
+        size_t row = block * MX_GEMV_BLOCK;
+        size_t len = g->m - row < MX_GEMV_BLOCK ? g->m - row : MX_GEMV_BLOCK;
+        if (g->rsa == 1) {
+            // columns of A are contiguous: accumulate x[p] * A[:, p] into a block of y that stays in L1
+            memset(acc, 0, len * sizeof(*acc));
+            for (size_t p = 0; p < g->k; p += MX_GEMV_ROWS) {
+                size_t cols = g->k - p < MX_GEMV_ROWS ? g->k - p : MX_GEMV_ROWS;
+                precision_type xs[MX_GEMV_ROWS];
+                for (size_t c = 0; c < cols; ++c) {
+                    xs[c] = g->x[(p + c) * g->incx];
+                }
+                kernels->gemv_cols(len, cols, g->a + row + p * g->csa, g->csa, xs, acc);
+            }
+        }
+        else {
+            // rows of A are contiguous: one dot product per row, MX_GEMV_ROWS rows per pass over x
+            for (size_t i = 0; i < len; i += MX_GEMV_ROWS) {
+                size_t rows = len - i < MX_GEMV_ROWS ? len - i : MX_GEMV_ROWS;
+                kernels->gemv(g->k, rows, g->a + (row + i) * g->rsa, g->rsa, g->x, acc + i);
+            }
+        }
+
+        for (size_t i = 0; i < len; ++i) {
+            precision_type value = g->alpha * acc[i];
+            acc[i] = g->beta == 0 ? value : value + g->beta * g->y[(row + i) * g->incy];
+        }
+        if (g->ep && g->ep_cols) {
+            __mx_epilogue_apply(g->ep, acc, len, row);
+        }
+        else if (g->ep) {
+            // every value sits in column 0 of the result and shares its bias
+            __mx_gemm_epilogue activation = {NULL, 0, g->ep->activation};
+            if (g->ep->bias) {
+                for (size_t i = 0; i < len; ++i) {
+                    acc[i] += g->ep->bias[0];
+                }
+            }
+            __mx_epilogue_apply(&activation, acc, len, 0);
+        }
+        for (size_t i = 0; i < len; ++i) {
+            g->y[(row + i) * g->incy] = acc[i];
+        }
+    }
+}
+
+static void __mx_gemv(__mx_gemv_args* g) {
+    precision_type* packed = NULL;
+    if (g->rsa != 1 && g->incx != 1) {
+        packed = __mx_aligned_alloc(sizeof(precision_type) * (g->k ? g->k : 1));
+        if (!packed) {
+            perror("Failed to allocate memory for the vector of a matrix-vector product.");
+            return;
+        }
+        for (size_t p = 0; p < g->k; ++p) {
+            packed[p] = g->x[p * g->incx];
+        }
+        g->x = packed;
+        g->incx = 1;
+    }
+
+    size_t blocks = (g->m + MX_GEMV_BLOCK - 1) / MX_GEMV_BLOCK;
+    if (g->m * g->k < MX_THREAD_THRESHOLD) {
+        __mx_gemv_task(0, blocks, g);
+    }
+    else {
+        size_t threads = mx_get_num_threads();
+        mx_parallel_for(blocks, (blocks + threads - 1) / threads, __mx_gemv_task, g);
+    }
+    __mx_aligned_free(packed);
+}
+
+// Routes products with a vector operand to __mx_gemv. Returns 0 when the matrix
+// operand has no unit stride, leaving the product to the GEMM path.
+static uint8_t __mx_dot_vector(const Matrix *src, const Matrix *dst1, const Matrix *dst2, precision_type alpha,
+                               precision_type beta, const __mx_gemm_epilogue* ep) {
+    __mx_gemv_args g = {0};
+    g.alpha = alpha;
+    g.beta = beta;
+    g.ep = ep;
+    g.k = dst1->cols;
+    if (dst2->cols == 1) {
+        // GEMV: src(m x 1) = dst1 * dst2(k x 1)
+        g.m = dst1->rows;
+        g.a = &AT(dst1, 0, 0);
+        g.rsa = dst1->row_stride;
+        g.csa = dst1->col_stride;
+        g.x = &AT(dst2, 0, 0);
+        g.incx = dst2->row_stride;
+        g.y = &AT(src, 0, 0);
+        g.incy = src->row_stride;
+    }
+    else {
+        // GEVM: src(1 x n) = dst1(1 x k) * dst2, run as dst2^T * dst1^T
+        g.m = dst2->cols;
+        g.a = &AT(dst2, 0, 0);
+        g.rsa = dst2->col_stride;
+        g.csa = dst2->row_stride;
+        g.x = &AT(dst1, 0, 0);
+        g.incx = dst1->col_stride;
+        g.y = &AT(src, 0, 0);
+        g.incy = src->col_stride;
+        g.ep_cols = 1;
+    }
+    if (g.rsa != 1 && g.csa != 1) {
+        return 0;
+    }
+    __mx_gemv(&g);
+    return 1;
+}
+
+typedef struct {
+    ThreadData rows;
+    size_t mr;
+    precision_type alpha;
+    precision_type beta;
+    const __mx_gemm_epilogue* ep;
+} __mx_dot_args;
+
+// computes rows [start_row, end_row) of src = alpha * dst1 * dst2 + beta * src
+static void __mx_dot_rows(const ThreadData* td, const __mx_dot_args* args) {
+    const Matrix* dst1 = td->dst1;
+    const Matrix* dst2 = td->dst2;
+    Matrix* src = td->src;
+    __mx_gemm(td->end_row - td->start_row, dst2->cols, dst1->cols, args->alpha,
+              &AT(dst1, td->start_row, 0), dst1->row_stride, dst1->col_stride,
+              &AT(dst2, 0, 0), dst2->row_stride, dst2->col_stride,
+              args->beta, &AT(src, td->start_row, 0), src->row_stride, src->col_stride, args->ep);
+}
+
+// pool task: [start, end) counts blocks of mr rows
+static void __mx_dot_task(size_t start, size_t end, void* arg) {
+    const __mx_dot_args* args = arg;
+    ThreadData td = args->rows;
+    td.start_row = start * args->mr;
+    if (end * args->mr < td.end_row) {
+        td.end_row = end * args->mr;
+    }
+    __mx_dot_rows(&td, args);
+}
+
+static void __mx_dot(const Matrix *src, const Matrix *dst1, const Matrix *dst2, precision_type alpha,
+                     precision_type beta, const __mx_gemm_epilogue* ep) {
+    size_t m = dst1->rows;
+    if ((m == 1 || dst2->cols == 1) && __mx_dot_vector(src, dst1, dst2, alpha, beta, ep)) {
+        return;
+    }
+    __mx_dot_args args = {{dst1, dst2, (Matrix*)src, 0, m}, __mx_simd()->gemm.mr, alpha, beta, ep};
+
+    if (m * dst2->cols * dst1->cols < MX_THREAD_THRESHOLD) {
+        __mx_dot_rows(&args.rows, &args);
+        return;
+    }
+
+    // one contiguous row block per thread, so B is packed once per thread
+    size_t blocks = (m + args.mr - 1) / args.mr;
+    size_t threads = mx_get_num_threads();
+    mx_parallel_for(blocks, (blocks + threads - 1) / threads, __mx_dot_task, &args);
+}
+
+// transposed header over the same data, for passing A^T to __mx_dot without a copy
+static Matrix __mx_transposed(const Matrix* matrix) {
+    Matrix transposed = *matrix;
+    transposed.rows = matrix->cols;
+    transposed.cols = matrix->rows;
+    transposed.row_stride = matrix->col_stride;
+    transposed.col_stride = matrix->row_stride;
+    return transposed;
+}
+
+void mx_fast_dot(const Matrix *src, const Matrix *dst1, const Matrix *dst2) {
+    __mx_dot(src, dst1, dst2, 1, 0, NULL);
+}
+
+uint8_t mx_dense_forward(Matrix* output, const Matrix* input, const Matrix* weights, const Matrix* bias, mx_op activation) {
+    if(CHECK_MATRIX_VALIDITY(output) == -1 || CHECK_MATRIX_VALIDITY(input) == -1 || CHECK_MATRIX_VALIDITY(weights) == -1){
+        return -1;
+    }
+    if(input->cols != weights->rows || output->rows != input->rows || output->cols != weights->cols){
+        printf("Error: matrices have incompatible dimensions for a dense layer.\n");
+        return -1;
+    }
+    if(bias && (CHECK_MATRIX_VALIDITY(bias) == -1 || bias->rows * bias->cols != output->cols)){
+        printf("Error: bias must hold one value per output column.\n");
+        return -1;
+    }
+    if(activation != MX_OP_IDENTITY && activation != MX_OP_SIGMOID && activation != MX_OP_TANH &&
+       activation != MX_OP_RELU && activation != MX_OP_EXP){
+        errno = EINVAL;
+        perror("Got an invalid activation for a dense layer.");
+        return -1;
+    }
+
+    __mx_gemm_epilogue ep = {NULL, 0, NULL};
+    if(bias){
+        // a row or a column vector, walked along whichever dimension holds the values
+        ep.bias = &AT(bias, 0, 0);
+        ep.bias_stride = bias->rows == 1 ? bias->col_stride : bias->row_stride;
+    }
+    if(activation != MX_OP_IDENTITY){
+        ep.activation = __mx_simd()->ops[activation];
+    }
+    __mx_dot(output, input, weights, 1, 0, &ep);
+    return 0;
+}
+
+// header over rows [row, row + rows) and columns [col, col + cols) of matrix, for passing blocks to __mx_dot
+static Matrix __mx_block(const Matrix* matrix, size_t row, size_t col, size_t rows, size_t cols) {
+    Matrix block = *matrix;
+    block.offset = matrix->offset + row * matrix->row_stride + col * matrix->col_stride;
+    block.rows = rows;
+    block.cols = cols;
+    return block;
+}
+
+static void __mx_swap_rows(Matrix* matrix, size_t a, size_t b) {
+    for (size_t j = 0; j < matrix->cols; ++j) {
+        precision_type tmp = AT(matrix, a, j);
+        AT(matrix, a, j) = AT(matrix, b, j);
+        AT(matrix, b, j) = tmp;
+    }
+}
+
+// row dst -= alpha * row src over columns [col, col + count)
+static void __mx_row_sub(Matrix* matrix, size_t dst, size_t src, precision_type alpha, size_t col, size_t count) {
+    precision_type* y = &AT(matrix, dst, col);
+    const precision_type* x = &AT(matrix, src, col);
+    if (matrix->col_stride == 1) {
+        __mx_simd()->ops[MX_OP_AXPY](count, x, y, -alpha, 0, y);
+        return;
+    }
+    for (size_t j = 0; j < count; ++j) {
+        y[j * matrix->col_stride] -= alpha * x[j * matrix->col_stride];
+    }
+}
+
+// factors columns [k, k + kb) of the rows below k, swapping whole rows; returns 1 on a zero pivot
+static uint8_t __mx_lu_panel(Matrix* a, size_t k, size_t kb, size_t* pivots) {
+    uint8_t singular = 0;
+    for (size_t j = k; j < k + kb; ++j) {
+        size_t pivot = j;
+        precision_type max = fabs(AT(a, j, j));
+        for (size_t i = j + 1; i < a->rows; ++i) {
+            precision_type value = fabs(AT(a, i, j));
+            if (value > max) {
+                max = value;
+                pivot = i;
+            }
+        }
+        pivots[j] = pivot;
+        if (pivot != j) {
+            __mx_swap_rows(a, j, pivot);
+        }
+        if (max == 0) {
+            singular = 1;
+            continue;
+        }
+        precision_type inv = 1 / AT(a, j, j);
+        for (size_t i = j + 1; i < a->rows; ++i) {
+            AT(a, i, j) *= inv;
+            __mx_row_sub(a, i, j, AT(a, i, j), j + 1, k + kb - j - 1);
+        }
+    }
+    return singular;
+}
+
+// Triangular kernels, left side only: the right side runs on transposed headers, as
+// X A = B is A^T X^T = B^T. Triangles are halved down to MX_TRSM_LEAF rows, so that all
+// but the leaves is a product on __mx_dot. Only the triangle named by flags is read.
+
+// the leaf of both kernels: B = A^-1 B, or B = A B with multiply, on the rows of x that
+// lie ld apart
+static void __mx_triangular_rows(const Matrix* a, precision_type* x, size_t ld, size_t cols, int flags,
+                                 uint8_t multiply) {
+    const __mx_kernels* kernels = __mx_simd();
+    size_t n = a->rows;
+    uint8_t upper = (flags & MX_UPPER) != 0;
+    uint8_t unit = (flags & MX_UNIT_DIAGONAL) != 0;
+    // a solve needs the rows on the triangle's side of row i finished, a product needs
+    // them untouched, so the two run in opposite directions
+    uint8_t forward = upper == multiply;
+    for (size_t step = 0; step < n; ++step) {
+        size_t i = forward ? step : n - 1 - step;
+        precision_type* row = x + i * ld;
+        if (multiply && !unit) {
+            kernels->ops[MX_OP_SCALE](cols, row, NULL, AT(a, i, i), 0, row);
+        }
+        for (size_t r = upper ? i + 1 : 0; r < (upper ? n : i); ++r) {
+            kernels->ops[MX_OP_AXPY](cols, x + r * ld, row, multiply ? AT(a, i, r) : -AT(a, i, r), 0, row);
+        }
+        if (!multiply && !unit) {
+            kernels->ops[MX_OP_SCALE](cols, row, NULL, 1 / AT(a, i, i), 0, row);
+        }
+    }
+}
+
+static void __mx_triangular_leaf(const Matrix* a, Matrix* b, int flags, uint8_t multiply) {
+    if (b->col_stride == 1) {
+        __mx_triangular_rows(a, &AT(b, 0, 0), b->row_stride, b->cols, flags, multiply);
+        return;
+    }
+    // strided rows, as on the right side: a chunk of columns at a time goes through a
+    // dense buffer
+    enum { chunk = 128 };
+    precision_type buffer[MX_TRSM_LEAF * chunk];
+    size_t n = a->rows;
+    for (size_t j0 = 0; j0 < b->cols; j0 += chunk) {
+        size_t len = b->cols - j0 < chunk ? b->cols - j0 : chunk;
+        for (size_t j = 0; j < len; ++j) {
+            for (size_t i = 0; i < n; ++i) {
+                buffer[i * len + j] = AT(b, i, j0 + j);
+            }
+        }
+        __mx_triangular_rows(a, buffer, len, len, flags, multiply);
+        for (size_t j = 0; j < len; ++j) {
+            for (size_t i = 0; i < n; ++i) {
+                AT(b, i, j0 + j) = buffer[i * len + j];
+            }
+        }
+    }
+}
+
+// about half of n, in whole leaves
+static size_t __mx_triangular_split(size_t n) {
+    return (n + MX_TRSM_LEAF - 1) / MX_TRSM_LEAF / 2 * MX_TRSM_LEAF;
+}
+
+// B = A^-1 B
+static void __mx_trsm_left(const Matrix* a, Matrix* b, int flags) {
+    size_t n = a->rows;
+    if (n > MX_TRSM_LEAF) {
+        size_t h = __mx_triangular_split(n);
+        Matrix a11 = __mx_block(a, 0, 0, h, h);
+        Matrix a22 = __mx_block(a, h, h, n - h, n - h);
+        Matrix b1 = __mx_block(b, 0, 0, h, b->cols);
+        Matrix b2 = __mx_block(b, h, 0, n - h, b->cols);
+        if (flags & MX_UPPER) {
+            Matrix a12 = __mx_block(a, 0, h, h, n - h);
+            __mx_trsm_left(&a22, &b2, flags);
+            __mx_dot(&b1, &a12, &b2, -1, 1, NULL);
+            __mx_trsm_left(&a11, &b1, flags);
+        }
+        else {
+            Matrix a21 = __mx_block(a, h, 0, n - h, h);
+            __mx_trsm_left(&a11, &b1, flags);
+            __mx_dot(&b2, &a21, &b1, -1, 1, NULL);
+            __mx_trsm_left(&a22, &b2, flags);
+        }
+        return;
+    }
+    __mx_triangular_leaf(a, b, flags, 0);
+}
+
+// B = A B
+static void __mx_trmm_left(const Matrix* a, Matrix* b, int flags) {
+    size_t n = a->rows;
+    if (n > MX_TRSM_LEAF) {
+        // each half of b is finished only after the other half has been read
+        size_t h = __mx_triangular_split(n);
+        Matrix a11 = __mx_block(a, 0, 0, h, h);
+        Matrix a22 = __mx_block(a, h, h, n - h, n - h);
+        Matrix b1 = __mx_block(b, 0, 0, h, b->cols);
+        Matrix b2 = __mx_block(b, h, 0, n - h, b->cols);
+        if (flags & MX_UPPER) {
+            Matrix a12 = __mx_block(a, 0, h, h, n - h);
+            __mx_trmm_left(&a11, &b1, flags);
+            __mx_dot(&b1, &a12, &b2, 1, 1, NULL);
+            __mx_trmm_left(&a22, &b2, flags);
+        }
+        else {
+            Matrix a21 = __mx_block(a, h, 0, n - h, h);
+            __mx_trmm_left(&a22, &b2, flags);
+            __mx_dot(&b2, &a21, &b1, 1, 1, NULL);
+            __mx_trmm_left(&a11, &b1, flags);
+        }
+        return;
+    }
+    __mx_triangular_leaf(a, b, flags, 1);
+}
+
+uint8_t mx_lu(Matrix* a, size_t* pivots) {
+    if (CHECK_MATRIX_VALIDITY(a) == -1 || !pivots) {
+        return -1;
+    }
+    if (a->rows != a->cols) {
+        printf("Error: LU factorization needs a square matrix.\n");
+        return -1;
+    }
+
+    size_t n = a->rows;
+    uint8_t singular = 0;
+    for (size_t k = 0; k < n; k += MX_LU_BLOCK) {
+        size_t kb = n - k < MX_LU_BLOCK ? n - k : MX_LU_BLOCK;
+        singular |= __mx_lu_panel(a, k, kb, pivots);
+        size_t rest = n - k - kb;
+        if (rest == 0) {
+            break;
+        }
+        // U12 = L11^-1 A12
+        Matrix l11 = __mx_block(a, k, k, kb, kb);
+        Matrix u12 = __mx_block(a, k, k + kb, kb, rest);
+        __mx_trsm_left(&l11, &u12, MX_LOWER | MX_UNIT_DIAGONAL);
+        // A22 -= L21 U12, where nearly all of the flops are
+        Matrix l21 = __mx_block(a, k + kb, k, rest, kb);
+        Matrix a22 = __mx_block(a, k + kb, k + kb, rest, rest);
+        __mx_dot(&a22, &l21, &u12, -1, 1, NULL);
+    }
+    return singular ? -1 : 0;
+}
+
+uint8_t mx_lu_solve(const Matrix* lu, const size_t* pivots, Matrix* b) {
+    if (CHECK_MATRIX_VALIDITY(lu) == -1 || CHECK_MATRIX_VALIDITY(b) == -1 || !pivots) {
+        return -1;
+    }
+    size_t n = lu->rows;
+    if (lu->cols != n || b->rows != n) {
+        printf("Error: right-hand side must have as many rows as the factorized matrix.\n");
+        return -1;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (AT(lu, i, i) == 0) {
+            return -1;
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        if (pivots[i] != i) {
+            __mx_swap_rows(b, i, pivots[i]);
+        }
+    }
+    __mx_trsm_left(lu, b, MX_LOWER | MX_UNIT_DIAGONAL);
+    __mx_trsm_left(lu, b, MX_UPPER);
+    return 0;
+}
+
+Matrix* mx_solve(const Matrix* a, const Matrix* b) {
+    if (CHECK_MATRIX_VALIDITY(a) == -1 || CHECK_MATRIX_VALIDITY(b) == -1) {
+        return NULL;
+    }
+    if (a->rows != a->cols || b->rows != a->rows) {
+        printf("Error: mx_solve needs a square matrix and a right-hand side with as many rows.\n");
+        return NULL;
+    }
+    Matrix* lu = MATRIX_COPY(a);
+    Matrix* x = MATRIX_COPY(b);
+    size_t* pivots = MX_MALLOC(sizeof(size_t) * a->rows);
+    if (!lu || !x || !pivots || mx_lu(lu, pivots) != 0 || mx_lu_solve(lu, pivots, x) != 0) {
+        mx_free(x);
+        x = NULL;
+    }
+    mx_free(lu);
+    MX_FREE(pivots);
+    return x;
+}
+
+uint8_t mx_inverse(Matrix *input, Matrix *output) {
+    if (CHECK_MATRIX_VALIDITY(input) == -1 || CHECK_MATRIX_VALIDITY(output) == -1) return -1;
+    size_t n = input->rows;
+    if (input->cols != n || output->rows != n || output->cols != n) return -1;
+
+    // solves A X = I against the LU factors; the input is left untouched
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            AT(output, i, j) = i == j;
+        }
+    }
+    Matrix* lu = MATRIX_COPY(input);
+    size_t* pivots = MX_MALLOC(sizeof(size_t) * n);
+    uint8_t result = -1;
+    if (lu && pivots && mx_lu(lu, pivots) == 0 && mx_lu_solve(lu, pivots, output) == 0) {
+        result = 1;
+    }
+    mx_free(lu);
+    MX_FREE(pivots);
+    return result;
+}
+
+typedef struct {
+    Matrix l11;
+    Matrix panel;
+} __mx_cholesky_args;
+
+// pool task: columns [start, end) of panel = L11^-1 panel
+static void __mx_cholesky_panel_task(size_t start, size_t end, void* arg) {
+    const __mx_cholesky_args* args = arg;
+    Matrix columns = __mx_block(&args->panel, 0, start, args->panel.rows, end - start);
+    __mx_trsm_left(&args->l11, &columns, MX_LOWER);
+}
+
+uint8_t mx_cholesky(Matrix* a) {
+    if (CHECK_MATRIX_VALIDITY(a) == -1) {
+        return -1;
+    }
+    if (a->rows != a->cols) {
+        printf("Error: Cholesky factorization needs a square matrix.\n");
+        return -1;
+    }
+
+    size_t n = a->rows;
+    // A21 is solved transposed, so that the substitution runs along contiguous rows
+    Matrix* scratch = MATRIX(n < MX_LU_BLOCK ? n : MX_LU_BLOCK, n);
+    if (!scratch) {
+        return -1;
+    }
+    for (size_t k = 0; k < n; k += MX_LU_BLOCK) {
+        size_t kb = n - k < MX_LU_BLOCK ? n - k : MX_LU_BLOCK;
+        // L11, from the diagonal block already updated by the previous panels
+        for (size_t j = k; j < k + kb; ++j) {
+            precision_type d = AT(a, j, j);
+            for (size_t r = k; r < j; ++r) {
+                d -= AT(a, j, r) * AT(a, j, r);
+            }
+            if (!(d > 0)) {
+                mx_free(scratch);
+                return -1;
+            }
+            d = sqrt(d);
+            AT(a, j, j) = d;
+            for (size_t i = j + 1; i < k + kb; ++i) {
+                precision_type sum = AT(a, i, j);
+                for (size_t r = k; r < j; ++r) {
+                    sum -= AT(a, i, r) * AT(a, j, r);
+                }
+                AT(a, i, j) = sum / d;
+            }
+        }
+        size_t rest = n - k - kb;
+        if (rest == 0) {
+            break;
+        }
 
-    Matrix* product;
-    if(matrix1->rows == 1 && matrix2->rows == 1){
-        Matrix* mx2_transposed = TRANSPOSE_VIEW(matrix2);
-        product = SAFE_DOT(matrix1, mx2_transposed);
-        mx_free(mx2_transposed);
+        // L21 = A21 L11^-T, solved as L11 L21^T = A21^T
+        __mx_cholesky_args args = {__mx_block(a, k, k, kb, kb), __mx_block(scratch, 0, 0, kb, rest)};
+        for (size_t i = 0; i < rest; ++i) {
+            for (size_t j = 0; j < kb; ++j) {
+                AT(&args.panel, j, i) = AT(a, k + kb + i, k + j);
+            }
+        }
+        if (rest * kb * kb < MX_THREAD_THRESHOLD) {
+            __mx_cholesky_panel_task(0, rest, &args);
+        }
+        else {
+            size_t threads = mx_get_num_threads();
+            mx_parallel_for(rest, (rest + threads - 1) / threads, __mx_cholesky_panel_task, &args);
+        }
+        for (size_t i = 0; i < rest; ++i) {
+            for (size_t j = 0; j < kb; ++j) {
+                AT(a, k + kb + i, k + j) = AT(&args.panel, j, i);
+            }
+        }
+
+        // A22 -= L21 L21^T on the lower triangle only, one block column at a time (SYRK)
+        for (size_t j = 0; j < rest; j += MX_LU_BLOCK) {
+            size_t jb = rest - j < MX_LU_BLOCK ? rest - j : MX_LU_BLOCK;
+            Matrix l_rows = __mx_block(a, k + kb + j, k, rest - j, kb);
+            Matrix l_cols = __mx_block(a, k + kb + j, k, jb, kb);
+            Matrix l_cols_t = __mx_transposed(&l_cols);
+            Matrix target = __mx_block(a, k + kb + j, k + kb + j, rest - j, jb);
+            __mx_dot(&target, &l_rows, &l_cols_t, -1, 1, NULL);
+        }
     }
-    else if( matrix1->cols == 1 && matrix2->cols ==1){
-        Matrix* mx1_transposed = TRANSPOSE_VIEW(matrix1);
-        product = SAFE_DOT(mx1_transposed, matrix2);
-        mx_free(mx1_transposed);
+
+    mx_free(scratch);
+    // the diagonal block products also wrote above the diagonal
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = i + 1; j < n; ++j) {
+            AT(a, i, j) = 0;
+        }
     }
-    else{
-        errno = EINVAL;
-        perror("Both matrices must be vectors.");
+    return 0;
+}
+
+uint8_t mx_cholesky_solve(const Matrix* l, Matrix* b) {
+    if (CHECK_MATRIX_VALIDITY(l) == -1 || CHECK_MATRIX_VALIDITY(b) == -1) {
         return -1;
     }
+    size_t n = l->rows;
+    if (l->cols != n || b->rows != n) {
+        printf("Error: right-hand side must have as many rows as the factorized matrix.\n");
+        return -1;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (AT(l, i, i) == 0) {
+            return -1;
+        }
+    }
+    // L y = b, then L^T x = y through a transposed header
+    Matrix l_t = __mx_transposed(l);
+    __mx_trsm_left(l, b, MX_LOWER);
+    __mx_trsm_left(&l_t, b, MX_UPPER);
+    return 0;
+}
 
-    float length1 = mx_length(matrix1);
-    float length2 = mx_length(matrix2);
+Matrix* mx_spd_solve(const Matrix* a, const Matrix* b) {
+    if (CHECK_MATRIX_VALIDITY(a) == -1 || CHECK_MATRIX_VALIDITY(b) == -1) {
+        return NULL;
+    }
+    if (a->rows != a->cols || b->rows != a->rows) {
+        printf("Error: mx_spd_solve needs a square matrix and a right-hand side with as many rows.\n");
+        return NULL;
+    }
+    Matrix* l = MATRIX_COPY(a);
+    Matrix* x = MATRIX_COPY(b);
+    if (!l || !x || mx_cholesky(l) != 0 || mx_cholesky_solve(l, x) != 0) {
+        mx_free(x);
+        x = NULL;
+    }
+    mx_free(l);
+    return x;
+}
 
-    if(length1 == 0 || length2 == 0) {
-        perror("One or both of the vectors have zero length.");
-        mx_free(product);
+// checks the shapes for mx_trsm and mx_trmm and sets up the left-side form of the call
+static uint8_t __mx_triangular_args(const Matrix* a, Matrix* b, int* flags, Matrix* a_view, Matrix* b_view) {
+    if (CHECK_MATRIX_VALIDITY(a) == -1 || CHECK_MATRIX_VALIDITY(b) == -1) {
+        return -1;
+    }
+    size_t n = *flags & MX_RIGHT ? b->cols : b->rows;
+    if (a->rows != a->cols || a->rows != n) {
+        printf("Error: triangular matrix must be square and match the %s of the other operand.\n",
+               *flags & MX_RIGHT ? "columns" : "rows");
         return -1;
     }
+    *a_view = *a;
+    *b_view = *b;
+    if (*flags & MX_RIGHT) {
+        // B A = (A^T B^T)^T, and the transpose of a lower triangle is upper
+        *a_view = __mx_transposed(a);
+        *b_view = __mx_transposed(b);
+        *flags ^= MX_UPPER;
+    }
+    return 0;
+}
 
-    float result = AT(product,0,0) / (length1 * length2);
-    mx_free(product);
-    return result;
+uint8_t mx_trsm(const Matrix* a, Matrix* b, int flags) {
+    Matrix a_view, b_view;
+    if (__mx_triangular_args(a, b, &flags, &a_view, &b_view) != 0) {
+        return -1;
+    }
+    if (!(flags & MX_UNIT_DIAGONAL)) {
+        for (size_t i = 0; i < a->rows; ++i) {
+            if (AT(a, i, i) == 0) {
+                return -1;
+            }
+        }
+    }
+    __mx_trsm_left(&a_view, &b_view, flags);
+    return 0;
 }
 
-Matrix* mx_perpendicular_new(const Matrix* matrix){
-    // Check if matrix is valid
-    if (CHECK_MATRIX_VALIDITY(matrix) == -1) {
-        errno = EINVAL;
-        perror("Error in 'mx_unit_vector_from'. Invalid matrix for this operation");
-        return NULL;
+uint8_t mx_trmm(const Matrix* a, Matrix* b, int flags) {
+    Matrix a_view, b_view;
+    if (__mx_triangular_args(a, b, &flags, &a_view, &b_view) != 0) {
+        return -1;
     }
-    // Check if matrix is in vector form
-    if (matrix->cols != 1 && matrix->rows != 1) {
-        errno = EINVAL;
-        perror("Matrix should be in vector form in order to calculate unit vector");
-        return NULL;    
+    __mx_trmm_left(&a_view, &b_view, flags);
+    return 0;
+}
+
+// machine epsilon of precision_type
+#ifdef USE_DOUBLE_PRECISION
+#define MX_EPSILON DBL_EPSILON
+#else
+#define MX_EPSILON FLT_EPSILON
+#endif
+
+// Householder QR. Each reflector H = I - tau v v^T is stored as v below the diagonal of
+// its column, with v[0] = 1 implied; R stays on and above the diagonal. A block of
+// reflectors H1..Hk is applied as I - V T V^T (compact WY), which turns the work into
+// matrix products.
+
+// unblocked factorization of a panel stored column by column (row_stride 1), so that
+// each reflector is a few passes of the SIMD kernels down contiguous columns
+static void __mx_qr_panel(Matrix* p, precision_type* tau) {
+    const __mx_kernels* kernels = __mx_simd();
+    for (size_t j = 0; j < p->cols; ++j) {
+        precision_type* v = &AT(p, j, j);
+        size_t len = p->rows - j - 1;   // entries of v below its implied 1
+        precision_type alpha = v[0];
+        precision_type norm2 = kernels->sum_squares(len, v + 1);
+        if (norm2 == 0) {
+            tau[j] = 0;
+            continue;
+        }
+        precision_type beta = -copysign(sqrt(alpha * alpha + norm2), alpha);
+        tau[j] = (beta - alpha) / beta;
+        kernels->ops[MX_OP_SCALE](len, v + 1, NULL, 1 / (alpha - beta), 0, v + 1);
+        v[0] = beta;
+
+        // columns to the right: c -= tau * v * (v^T c)
+        for (size_t q = j + 1; q < p->cols; q += MX_GEMV_ROWS) {
+            size_t count = p->cols - q < MX_GEMV_ROWS ? p->cols - q : MX_GEMV_ROWS;
+            precision_type s[MX_GEMV_ROWS];
+            kernels->gemv(len, count, &AT(p, j + 1, q), p->col_stride, v + 1, s);
+            for (size_t c = 0; c < count; ++c) {
+                precision_type* column = &AT(p, j + 1, q + c);
+                precision_type scale = tau[j] * (s[c] + AT(p, j, q + c));
+                AT(p, j, q + c) -= scale;
+                kernels->ops[MX_OP_AXPY](len, v + 1, column, -scale, 0, column);
+            }
+        }
     }
-    Matrix* m_copy = MATRIX_COPY(matrix);
-    if(m_copy->rows == 2 || m_copy->cols == 2){
-        swap(&AT(m_copy,0,0), &AT(m_copy,0,1));
-        AT(m_copy,0,0) *= -1;
-        return m_copy;
+}
+
+// c = Q^T c, or c = Q c when transpose is 0, for the kb reflectors stored in the first kb
+// columns of v (rows of v and c match)
+static uint8_t __mx_qr_apply_block(const Matrix* v, const precision_type* tau, size_t kb, Matrix* c,
+                                   uint8_t transpose) {
+    size_t rows = v->rows;
+    size_t nc = c->cols;
+    Matrix* v1 = MATRIX(kb, kb);
+    Matrix* t = MATRIX(kb, kb);
+    Matrix* g = MATRIX(kb, kb);
+    Matrix* w = MATRIX(kb, nc);
+    Matrix* w2 = MATRIX(kb, nc);
+    uint8_t result = -1;
+    if (!v1 || !t || !g || !w || !w2) {
+        goto cleanup;
     }
-    if(m_copy->rows == 3 || m_copy->cols == 3){
-        // Base vectors
-        Matrix* x_base = MATRIX(1, 3);
-        AT(x_base, 0, 0) = 1; AT(x_base, 0, 1) = 0; AT(x_base, 0, 2) = 0;
 
-        Matrix* y_base = MATRIX(1, 3);
-        AT(y_base, 0, 0) = 0; AT(y_base, 0, 1) = 1; AT(y_base, 0, 2) = 0;
+    // V = [V1; V2]: V1 is unit lower triangular and shares its storage with R, so it is
+    // copied out; V2 is used in place
+    for (size_t i = 0; i < kb; ++i) {
+        for (size_t j = 0; j < kb; ++j) {
+            AT(v1, i, j) = i == j ? 1 : (i > j ? AT(v, i, j) : 0);
+        }
+    }
+    Matrix v1_t = __mx_transposed(v1);
+    Matrix v2 = __mx_block(v, kb, 0, rows - kb, kb);
+    Matrix v2_t = __mx_transposed(&v2);
 
-        // If vec is not parallel to x_base, use x_base
-        Matrix* base_to_use = x_base;
-        if (fabs(AT(m_copy, 0, 0)) > 0.99) {  // Here 0.99 is an arbitrary threshold, adjust as needed
-            base_to_use = y_base;  // Use y_base if vec is nearly parallel to x_base
+    // T from tau and G = V^T V, column by column: T[0:i, i] = -tau_i T[0:i, 0:i] G[0:i, i]
+    __mx_dot(g, &v1_t, v1, 1, 0, NULL);
+    if (rows > kb) {
+        __mx_dot(g, &v2_t, &v2, 1, 1, NULL);
+    }
+    for (size_t i = 0; i < kb; ++i) {
+        for (size_t r = 0; r < kb; ++r) {
+            precision_type sum = 0;
+            for (size_t q = r; q < i; ++q) {
+                sum += AT(t, r, q) * AT(g, q, i);
+            }
+            AT(t, r, i) = r < i ? -tau[i] * sum : (r == i ? tau[i] : 0);
         }
+    }
 
-        Matrix* perpendicular = mx_cross_product_alloc(m_copy, base_to_use);
-        mx_free(m_copy);
-        mx_free(y_base);
-        mx_free(x_base);
-        return perpendicular;
+    // C -= V (T^T (V^T C)), with T in place of T^T for Q C
+    Matrix c1 = __mx_block(c, 0, 0, kb, nc);
+    Matrix c2 = __mx_block(c, kb, 0, rows - kb, nc);
+    Matrix t_t = __mx_transposed(t);
+    __mx_dot(w, &v1_t, &c1, 1, 0, NULL);
+    if (rows > kb) {
+        __mx_dot(w, &v2_t, &c2, 1, 1, NULL);
     }
-    errno = EINVAL;
-    perror("ERROR: infinite many perpendiculars for more then 3 dimensional vector");
-    return NULL;
+    __mx_dot(w2, transpose ? &t_t : t, w, 1, 0, NULL);
+    __mx_dot(&c1, v1, w2, -1, 1, NULL);
+    if (rows > kb) {
+        __mx_dot(&c2, &v2, w2, -1, 1, NULL);
+    }
+    result = 0;
 
+cleanup:
+    mx_free(v1);
+    mx_free(t);
+    mx_free(g);
+    mx_free(w);
+    mx_free(w2);
+    return result;
 }
 
-Matrix* mx_unit_vector_from(const Matrix* matrix) {
-    // Check if matrix is valid
-    if (CHECK_MATRIX_VALIDITY(matrix) == -1) {
-        errno = EINVAL;
-        perror("Error in 'mx_unit_vector_from'. Invalid matrix for this operation");
-        return NULL;
+// factors the first n columns of a and applies the reflectors to the columns after them
+static uint8_t __mx_qr_factor(Matrix* a, size_t n, precision_type* tau) {
+    size_t m = a->rows;
+    // each panel is factored in a column-major copy: the reflectors walk down columns
+    Matrix* scratch = MATRIX(n < MX_QR_BLOCK ? n : MX_QR_BLOCK, m);
+    if (!scratch) {
+        return -1;
+    }
+    uint8_t result = 0;
+    for (size_t k = 0; k < n && result == 0; k += MX_QR_BLOCK) {
+        size_t kb = n - k < MX_QR_BLOCK ? n - k : MX_QR_BLOCK;
+        Matrix columns = __mx_block(scratch, 0, 0, kb, m - k);
+        Matrix panel = __mx_transposed(&columns);
+        for (size_t i = 0; i < m - k; ++i) {
+            for (size_t j = 0; j < kb; ++j) {
+                AT(&panel, i, j) = AT(a, k + i, k + j);
+            }
+        }
+        __mx_qr_panel(&panel, tau + k);
+        for (size_t i = 0; i < m - k; ++i) {
+            for (size_t j = 0; j < kb; ++j) {
+                AT(a, k + i, k + j) = AT(&panel, i, j);
+            }
+        }
+        if (k + kb < a->cols) {
+            Matrix trailing = __mx_block(a, k, k + kb, m - k, a->cols - k - kb);
+            result = __mx_qr_apply_block(&panel, tau + k, kb, &trailing, 1);
+        }
     }
+    mx_free(scratch);
+    return result;
+}
 
-    // Check if matrix is in vector form
-    if (matrix->cols != 1 && matrix->rows != 1) {
-        errno = EINVAL;
-        perror("Matrix should be in vector form in order to calculate unit vector");
-        return NULL;    
+uint8_t mx_qr(Matrix* a, precision_type* tau) {
+    if (CHECK_MATRIX_VALIDITY(a) == -1 || !tau) {
+        return -1;
+    }
+    if (a->rows < a->cols) {
+        printf("Error: QR factorization needs at least as many rows as columns.\n");
+        return -1;
     }
+    return __mx_qr_factor(a, a->cols, tau);
+}
 
-    Matrix* result = MATRIX_COPY(matrix);
-    float length = mx_length(matrix);
+uint8_t mx_qr_apply_qt(const Matrix* qr, const precision_type* tau, Matrix* b) {
+    if (CHECK_MATRIX_VALIDITY(qr) == -1 || CHECK_MATRIX_VALIDITY(b) == -1 || !tau) {
+        return -1;
+    }
+    if (b->rows != qr->rows || qr->rows < qr->cols) {
+        printf("Error: right-hand side must have as many rows as the factorized matrix.\n");
+        return -1;
+    }
+    size_t m = qr->rows;
+    size_t n = qr->cols;
+    for (size_t k = 0; k < n; k += MX_QR_BLOCK) {
+        size_t kb = n - k < MX_QR_BLOCK ? n - k : MX_QR_BLOCK;
+        Matrix v = __mx_block(qr, k, k, m - k, kb);
+        Matrix rows = __mx_block(b, k, 0, m - k, b->cols);
+        if (__mx_qr_apply_block(&v, tau + k, kb, &rows, 1) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
 
-    // Check if length is close to zero
-    if (fabs(length) < 1e-6) {
-        errno = EINVAL;
-        perror("Error in 'mx_unit_vector_from'. Vector length is too close to zero");
-        mx_free(result);  // MX_FREE the allocated matrix before returning
+Matrix* mx_lstsq(const Matrix* a, const Matrix* b) {
+    if (CHECK_MATRIX_VALIDITY(a) == -1 || CHECK_MATRIX_VALIDITY(b) == -1) {
         return NULL;
     }
-
-    for (size_t i = 0; i < result->rows; ++i) {
-        for (size_t j = 0; j < result->cols; ++j) {
-            AT(result,i,j) /= length;
+    if (a->rows < a->cols || b->rows != a->rows) {
+        printf("Error: mx_lstsq needs at least as many rows as columns and a right-hand side with as many rows.\n");
+        return NULL;
+    }
+    size_t m = a->rows;
+    size_t n = a->cols;
+    size_t k = b->cols;
+    // [A | B] is factored as a whole, so Q^T B comes out of the trailing updates
+    Matrix* qr = MATRIX(m, n + k);
+    precision_type* tau = MX_MALLOC(sizeof(precision_type) * n);
+    Matrix* x = NULL;
+    if (qr && tau) {
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                AT(qr, i, j) = AT(a, i, j);
+            }
+            for (size_t j = 0; j < k; ++j) {
+                AT(qr, i, n + j) = AT(b, i, j);
+            }
         }
     }
-
-    return result;
+    if (qr && tau && __mx_qr_factor(qr, n, tau) == 0) {
+        // x = R^-1 (Q^T B)[0:n]. Rounding keeps the diagonal of R off exact zero even
+        // when A is rank deficient, so entries that are negligible next to the largest
+        // one count as zero
+        precision_type largest = 0;
+        for (size_t i = 0; i < n; ++i) {
+            largest = fmax(largest, fabs(AT(qr, i, i)));
+        }
+        precision_type tolerance = largest * (m > n ? m : n) * MX_EPSILON;
+        uint8_t full_rank = largest > 0;
+        for (size_t i = 0; i < n; ++i) {
+            full_rank &= fabs(AT(qr, i, i)) > tolerance;
+        }
+        if (full_rank) {
+            Matrix r = __mx_block(qr, 0, 0, n, n);
+            Matrix top = __mx_block(qr, 0, n, n, k);
+            __mx_trsm_left(&r, &top, MX_UPPER);
+            x = mx_slice_copy(qr, 0, n - 1, n, n + k - 1);
+        }
+    }
+    mx_free(qr);
+    MX_FREE(tau);
+    return x;
 }
 
+// Symmetric eigensolver: Householder reduction to a tridiagonal T = Q^T A Q, then implicit
+// QL sweeps with Wilkinson shifts on T. The eigenvectors are kept as the rows of V^T, so
+// both the reflectors and the plane rotations of the sweeps work on contiguous rows.
 
-uint8_t mx_equal(Matrix* matrix1, Matrix* matrix2){
-    if(!VALID_MATRIX(matrix1) || !VALID_MATRIX(matrix2)) {
-        perror("Invalid matrix dimensions.");
-        return 0;
+// reduces the symmetric w in place; d and e receive the diagonal and the off-diagonal of
+// T, and row k of w keeps the reflector of step k from column k + 1 on, with v[0] = 1
+static void __mx_tridiagonalize(Matrix* w, precision_type* tau, double* d, double* e, precision_type* p) {
+    const __mx_kernels* kernels = __mx_simd();
+    size_t n = w->rows;
+    for (size_t k = 0; k + 2 < n; ++k) {
+        size_t len = n - k - 1;                 // order of the trailing block A22
+        precision_type* v = &AT(w, k, k + 1);   // row k stands in for column k
+        precision_type alpha = v[0];
+        precision_type norm2 = kernels->sum_squares(len - 1, v + 1);
+        d[k] = AT(w, k, k);
+        if (norm2 == 0) {
+            tau[k] = 0;
+            e[k] = alpha;
+            continue;
+        }
+        precision_type beta = -copysign(sqrt(alpha * alpha + norm2), alpha);
+        tau[k] = (beta - alpha) / beta;
+        kernels->ops[MX_OP_SCALE](len - 1, v + 1, NULL, 1 / (alpha - beta), 0, v + 1);
+        e[k] = beta;
+        v[0] = 1;
+
+        // p = tau A22 v, then p -= (tau / 2) (p^T v) v
+        for (size_t i = 0; i < len; i += MX_GEMV_ROWS) {
+            size_t count = len - i < MX_GEMV_ROWS ? len - i : MX_GEMV_ROWS;
+            kernels->gemv(len, count, &AT(w, k + 1 + i, k + 1), w->row_stride, v, p + i);
+        }
+        kernels->ops[MX_OP_SCALE](len, p, NULL, tau[k], 0, p);
+        precision_type pv;
+        kernels->gemv(len, 1, p, 0, v, &pv);
+        kernels->ops[MX_OP_AXPY](len, v, p, -tau[k] / 2 * pv, 0, p);
+
+        // A22 -= v p^T + p v^T, both triangles, so the next gemv reads whole rows
+        for (size_t i = 0; i < len; ++i) {
+            precision_type* row = &AT(w, k + 1 + i, k + 1);
+            kernels->ops[MX_OP_AXPY](len, p, row, -v[i], 0, row);
+            kernels->ops[MX_OP_AXPY](len, v, row, -p[i], 0, row);
+        }
     }
-    if(matrix1->rows != matrix2->rows || matrix1->cols != matrix2->cols){
-        return 0;
+    if (n >= 2) {
+        d[n - 2] = AT(w, n - 2, n - 2);
+        e[n - 2] = AT(w, n - 2, n - 1);
     }
-    for(size_t i = 0; i < matrix1->rows; ++i){
-        for(size_t j =0; j<matrix1->cols; ++j){
-            if(AT(matrix1,i,j) != AT(matrix2,i,j)){
-                return 0;
+    d[n - 1] = AT(w, n - 1, n - 1);
+    e[n - 1] = 0;
+}
+
+// zt = Q^T = H(n-3) .. H(0), built as I H(n-3) .. H(0): H(k) only touches rows and columns
+// from k + 1 on, and the product so far is the identity outside of them
+static void __mx_tridiagonal_basis(const Matrix* w, const precision_type* tau, Matrix* zt) {
+    const __mx_kernels* kernels = __mx_simd();
+    size_t n = w->rows;
+    for (size_t i = 0; i < n; ++i) {
+        AT(zt, i, i) = 1;
+    }
+    size_t steps = n > 2 ? n - 2 : 0;
+    for (size_t k = steps; k-- > 0;) {
+        if (tau[k] == 0) {
+            continue;
+        }
+        size_t len = n - k - 1;
+        const precision_type* v = &AT(w, k, k + 1);
+        for (size_t i = 0; i < len; i += MX_GEMV_ROWS) {
+            size_t count = len - i < MX_GEMV_ROWS ? len - i : MX_GEMV_ROWS;
+            precision_type s[MX_GEMV_ROWS];
+            kernels->gemv(len, count, &AT(zt, k + 1 + i, k + 1), zt->row_stride, v, s);
+            for (size_t c = 0; c < count; ++c) {
+                precision_type* row = &AT(zt, k + 1 + i + c, k + 1);
+                kernels->ops[MX_OP_AXPY](len, v, row, -tau[k] * s[c], 0, row);
             }
         }
     }
-    return 1;
 }
 
-Matrix* mx_transpose(Matrix* matrix, uint8_t flags){
-    Matrix* mx_transposed;
-    if(CHECK_MATRIX_VALIDITY(matrix) == -1){
-        return NULL;
+// applies the rotations of one QL sweep, (c[i], s[i]) to rows i and i + 1 of zt for i from
+// last down to first, a chunk of columns at a time so the rows stay in cache
+static void __mx_rotate_rows(Matrix* zt, size_t first, size_t last, const precision_type* c,
+                             const precision_type* s) {
+    size_t n = zt->cols;
+    for (size_t q0 = 0; q0 < n; q0 += 256) {
+        size_t len = n - q0 < 256 ? n - q0 : 256;
+        for (size_t i = last + 1; i-- > first;) {
+            precision_type* zi = &AT(zt, i, q0);
+            precision_type* zj = &AT(zt, i + 1, q0);
+            __mx_vec zero = {0}, vc = zero + c[i], vs = zero + s[i], x, y;
+            size_t q = 0;
+            for (; q + MX_VEC_LANES <= len; q += MX_VEC_LANES) {
+                memcpy(&x, zi + q, sizeof(x));
+                memcpy(&y, zj + q, sizeof(y));
+                __mx_vec rx = vc * x - vs * y;
+                __mx_vec ry = vs * x + vc * y;
+                memcpy(zi + q, &rx, sizeof(rx));
+                memcpy(zj + q, &ry, sizeof(ry));
+            }
+            for (; q < len; ++q) {
+                precision_type t = zj[q];
+                zj[q] = s[i] * zi[q] + c[i] * t;
+                zi[q] = c[i] * zi[q] - s[i] * t;
+            }
+        }
     }
+}
 
-    if(CHECK_FLAG(flags,0) == 1){
-        float rows = matrix->rows;
-        matrix->rows = matrix->cols;
-        matrix->cols = rows;
-        
-        float row_stride = matrix->row_stride;    
-        matrix->row_stride = matrix->col_stride;      
-        matrix->col_stride = row_stride;
-        return matrix; 
+// implicit QL on the tridiagonal (d, e), rotating the rows of zt along when it is given;
+// d ends up holding the eigenvalues. rotations is scratch for 2 * n values
+static uint8_t __mx_tridiagonal_ql(double* d, double* e, size_t n, Matrix* zt, precision_type* rotations) {
+    for (size_t l = 0; l < n; ++l) {
+        size_t iterations = 0;
+        size_t m;
+        do {
+            // look for a negligible off-diagonal entry to split the matrix at
+            for (m = l; m + 1 < n; ++m) {
+                double dd = fabs(d[m]) + fabs(d[m + 1]);
+                if (fabs(e[m]) <= DBL_EPSILON * dd) {
+                    break;
+                }
+            }
+            if (m == l) {
+                break;
+            }
+            if (++iterations > 30) {
+                printf("Error: eigenvalue iteration did not converge.\n");
+                return -1;
+            }
+            double g = (d[l + 1] - d[l]) / (2 * e[l]);
+            double r = hypot(g, 1);
+            g = d[m] - d[l] + e[l] / (g + copysign(r, g));
+            double s = 1, c = 1, p = 0;
+            uint8_t deflated = 0;
+            size_t first = l;
+            for (size_t i = m; i-- > l;) {
+                double f = s * e[i];
+                double b = c * e[i];
+                e[i + 1] = r = hypot(f, g);
+                if (r == 0) {
+                    // underflow: deflate and restart the sweep
+                    d[i + 1] -= p;
+                    e[m] = 0;
+                    deflated = 1;
+                    first = i + 1;
+                    break;
+                }
+                s = f / r;
+                c = g / r;
+                g = d[i + 1] - p;
+                r = (d[i] - g) * s + 2 * c * b;
+                p = s * r;
+                d[i + 1] = g + p;
+                g = c * r - b;
+                rotations[i] = c;
+                rotations[n + i] = s;
+            }
+            if (zt && first < m) {
+                __mx_rotate_rows(zt, first, m - 1, rotations, rotations + n);
+            }
+            if (deflated) {
+                continue;
+            }
+            d[l] -= p;
+            e[l] = g;
+            e[m] = 0;
+        } while (m != l);
+    }
+    return 0;
+}
 
+uint8_t mx_eigh(const Matrix* a, precision_type* eigenvalues, Matrix* eigenvectors) {
+    if (CHECK_MATRIX_VALIDITY(a) == -1 || !eigenvalues) {
+        return -1;
     }
-    else if(CHECK_FLAG(flags,2) == 1){
-        mx_transposed = MATRIX_COPY(matrix);
-        if(!mx_transposed){
-            return NULL;
+    size_t n = a->rows;
+    if (a->cols != n || (eigenvectors && (eigenvectors->rows != n || eigenvectors->cols != n))) {
+        printf("Error: mx_eigh needs a square matrix and eigenvectors of the same size.\n");
+        return -1;
+    }
+    Matrix* w = MATRIX(n, n);
+    Matrix* zt = eigenvectors ? MATRIX(n, n) : NULL;
+    precision_type* tau = MX_MALLOC(sizeof(precision_type) * 3 * n);
+    double* d = MX_MALLOC(sizeof(double) * 2 * n);
+    uint8_t result = -1;
+    if (!w || (eigenvectors && !zt) || !tau || !d) {
+        goto cleanup;
+    }
+    double* e = d + n;
+
+    // the lower triangle is mirrored, so the reduction works on full rows
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j <= i; ++j) {
+            AT(w, i, j) = AT(w, j, i) = AT(a, i, j);
         }
     }
-    else {
-        mx_transposed = MATRIX_VIEW(matrix);
-        if(!mx_transposed){
-            return NULL;
+    __mx_tridiagonalize(w, tau, d, e, tau + n);
+    if (zt) {
+        __mx_tridiagonal_basis(w, tau, zt);
+    }
+    if (__mx_tridiagonal_ql(d, e, n, zt, tau + n) != 0) {
+        goto cleanup;
+    }
+
+    // ascending order, with the eigenvector rows following their eigenvalues
+    for (size_t i = 0; i < n; ++i) {
+        size_t min = i;
+        for (size_t j = i + 1; j < n; ++j) {
+            min = d[j] < d[min] ? j : min;
+        }
+        double tmp = d[i];
+        d[i] = d[min];
+        d[min] = tmp;
+        if (zt && min != i) {
+            __mx_swap_rows(zt, i, min);
         }
+        eigenvalues[i] = d[i];
     }
+    if (zt) {
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                AT(eigenvectors, j, i) = AT(zt, i, j);
+            }
+        }
+    }
+    result = 0;
 
-    mx_transposed->rows = matrix->cols;
-    mx_transposed->cols = matrix->rows;
-    mx_transposed->row_stride = matrix->col_stride;          
-    mx_transposed->col_stride = matrix->row_stride; 
+cleanup:
+    mx_free(w);
+    mx_free(zt);
+    MX_FREE(tau);
+    MX_FREE(d);
+    return result;
+}
 
-    return mx_transposed;
+// replaces the columns of y (rows >= cols) with an orthonormal basis of their span: the Q
+// of a Householder QR, formed by applying the reflectors to the leading columns of I
+static uint8_t __mx_orthonormalize(Matrix* y) {
+    size_t m = y->rows;
+    size_t n = y->cols;
+    Matrix* q = MATRIX(m, n);
+    precision_type* tau = MX_MALLOC(sizeof(precision_type) * n);
+    uint8_t result = -1;
+    if (q && tau && __mx_qr_factor(y, n, tau) == 0) {
+        for (size_t i = 0; i < n; ++i) {
+            AT(q, i, i) = 1;
+        }
+        // last block first; block k leaves the columns before k, still unit vectors, alone
+        result = 0;
+        for (size_t b = (n + MX_QR_BLOCK - 1) / MX_QR_BLOCK; b-- > 0 && result == 0;) {
+            size_t k = b * MX_QR_BLOCK;
+            size_t kb = n - k < MX_QR_BLOCK ? n - k : MX_QR_BLOCK;
+            Matrix v = __mx_block(y, k, k, m - k, kb);
+            Matrix rows = __mx_block(q, k, k, m - k, n - k);
+            result = __mx_qr_apply_block(&v, tau + k, kb, &rows, 0);
+        }
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                AT(y, i, j) = AT(q, i, j);
+            }
+        }
+    }
+    mx_free(q);
+    MX_FREE(tau);
+    return result;
 }
 
-Matrix* mx_arrange_alloc(size_t rows, size_t cols, float start_arrange) {
-    Matrix* matrix = MATRIX(rows, cols);
-    if (!matrix) {
-        printf("Failed to allocate memory for the matrix.\n");
-        return NULL;
+uint8_t mx_svd_truncated(const Matrix* a, size_t k, Matrix* u, precision_type* s, Matrix* v) {
+    if (CHECK_MATRIX_VALIDITY(a) == -1 || !s) {
+        return -1;
+    }
+    size_t m = a->rows;
+    size_t n = a->cols;
+    size_t rank = m < n ? m : n;
+    if (k == 0 || k > rank || (u && (u->rows != m || u->cols != k)) || (v && (v->rows != n || v->cols != k))) {
+        printf("Error: mx_svd_truncated needs 0 < k <= min(rows, cols), u of rows x k and v of cols x k.\n");
+        return -1;
+    }
+    size_t l = k + MX_SVD_OVERSAMPLING < rank ? k + MX_SVD_OVERSAMPLING : rank;
+    Matrix a_t = __mx_transposed(a);
+    Matrix* y = MATRIX(m, l);
+    Matrix* z = MATRIX(n, l);
+    Matrix* gram = MATRIX(l, l);
+    Matrix* basis = MATRIX(l, l);
+    Matrix* top = MATRIX(l, k);
+    precision_type* lambda = MX_MALLOC(sizeof(precision_type) * l);
+    uint8_t result = -1;
+    if (!y || !z || !gram || !basis || !top || !lambda) {
+        goto cleanup;
+    }
+
+    // range finder: Q spans A * Omega, sharpened by power iterations that re-orthonormalize
+    // after every product so the small singular directions are not lost to rounding
+    mx_set_to_rand(z, -1, 1);
+    __mx_dot(y, a, z, 1, 0, NULL);
+    if (__mx_orthonormalize(y) != 0) {
+        goto cleanup;
+    }
+    for (size_t it = 0; it < MX_SVD_POWER_ITERATIONS; ++it) {
+        __mx_dot(z, &a_t, y, 1, 0, NULL);
+        if (__mx_orthonormalize(z) != 0) {
+            goto cleanup;
+        }
+        __mx_dot(y, a, z, 1, 0, NULL);
+        if (__mx_orthonormalize(y) != 0) {
+            goto cleanup;
+        }
     }
 
-    for(size_t i=0; i< matrix->rows; ++i){
-        for(size_t j=0; j< matrix->cols; ++j, start_arrange++){
-            AT(matrix, i, j) = start_arrange;
+    // B = Q^T A is l x n and kept as Z = B^T; B B^T = W S^2 W^T gives S and W, then
+    // U = Q W and V = B^T W S^-1
+    __mx_dot(z, &a_t, y, 1, 0, NULL);
+    Matrix z_t = __mx_transposed(z);
+    __mx_dot(gram, &z_t, z, 1, 0, NULL);
+    if (mx_eigh(gram, lambda, basis) != 0) {
+        goto cleanup;
+    }
+    for (size_t i = 0; i < k; ++i) {
+        size_t c = l - 1 - i;
+        s[i] = lambda[c] > 0 ? sqrt(lambda[c]) : 0;
+        for (size_t r = 0; r < l; ++r) {
+            AT(top, r, i) = AT(basis, r, c);
+        }
+    }
+    if (u) {
+        __mx_dot(u, y, top, 1, 0, NULL);
+    }
+    if (v) {
+        __mx_dot(v, z, top, 1, 0, NULL);
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < k; ++j) {
+                AT(v, i, j) = s[j] > 0 ? AT(v, i, j) / s[j] : 0;
+            }
         }
     }
+    result = 0;
 
-    return matrix;
+cleanup:
+    mx_free(y);
+    mx_free(z);
+    mx_free(gram);
+    mx_free(basis);
+    mx_free(top);
+    MX_FREE(lambda);
+    return result;
 }
 
-Matrix* mx_scale(Matrix* matrix, float scalar) {
-    Matrix* result = MATRIX_COPY(matrix);
-    if (!result) {
-        printf("Failed to allocate memory for the scaled matrix.\n");
-        return NULL;
+static void __mx_set_zero(Matrix* matrix){
+    for(size_t i = 0; i < matrix->rows; ++i){
+        for(size_t j = 0; j < matrix->cols; ++j){
+            AT(matrix, i, j) = 0;
+        }
     }
+}
 
-    for(size_t i = 0; i < matrix->rows; ++i) {
-        for(size_t j = 0; j < matrix->cols; ++j) {
-            AT(result, i, j) = AT(result, i, j) * scalar;
+uint8_t mx_nn_set_batch(NN* nn, size_t batch){
+    if(batch == 0){
+        errno = EINVAL;
+        perror("Batch size must be positive.");
+        return -1;
+    }
+    Matrix** grown = MX_MALLOC((nn->count + 1) * sizeof(Matrix*));
+    if(!grown){
+        return -1;
+    }
+    // allocate every replacement before touching the network, so a failure leaves it as it was
+    size_t l = 0;
+    for(; l <= nn->count; ++l){
+        const Matrix* a = nn->as[l];
+        grown[l] = NULL;
+        // reuse the buffer when it is ours, dense and large enough
+        if(a->container->ref_count == 1 && a->offset == 0 && a->col_stride == 1 && a->row_stride == a->cols &&
+           a->container->size >= batch * a->cols){
+            continue;
+        }
+        // the activations belong to the network, not to the caller's arena scope; only the
+        // allocation leaves it, so freeing old arena-backed activations still sees the arena
+        size_t depth = __mx_arena_depth;
+        __mx_arena_depth = 0;
+        grown[l] = MATRIX(batch, a->cols);
+        __mx_arena_depth = depth;
+        if(!grown[l]){
+            break;
         }
     }
-
-    return result;
+    if(l <= nn->count){
+        while(l-- > 0){
+            mx_free(grown[l]);
+        }
+        MX_FREE(grown);
+        return -1;
+    }
+    for(l = 0; l <= nn->count; ++l){
+        if(grown[l]){
+            mx_free(nn->as[l]);
+            nn->as[l] = grown[l];
+        }
+        else{
+            nn->as[l]->rows = batch;
+        }
+    }
+    MX_FREE(grown);
+    return 0;
 }
 
-Matrix* mx_rand_alloc(size_t rows, size_t cols) {
-    Matrix* matrix = MATRIX(rows, cols);
-    if (!matrix) {
-        printf("Failed to allocate memory for the matrix.\n");
-        return NULL;
+void mx_nn_forward(NN* nn){
+    for(size_t i = 0; i < nn->count; ++i){
+        mx_dense_forward(nn->as[i+1], nn->as[i], nn->ws[i], nn->bs[i], MX_OP_SIGMOID);
     }
+}
 
-    for(size_t i = 0; i < matrix->rows; ++i) {
-        for(size_t j = 0; j < matrix->cols; ++j) {
-            float value = (float)((double)rand() / RAND_MAX);
-            AT(matrix, i, j) = value;
+// sets the batch to `count` and copies rows [start, start + count) of ti into the input layer
+static uint8_t __mx_nn_load_rows(NN* nn, const Matrix* ti, size_t start, size_t count){
+    if(mx_nn_set_batch(nn, count) != 0){
+        return -1;
+    }
+    Matrix* input = nn->as[0];
+    for(size_t i = 0; i < count; ++i){
+        for(size_t j = 0; j < ti->cols; ++j){
+            AT(input, i, j) = AT(ti, start + i, j);
         }
     }
+    return 0;
+}
 
-    return matrix;
+uint8_t mx_nn_forward_batch(NN* nn, const Matrix* input){
+    if(CHECK_MATRIX_VALIDITY(input) == -1){
+        return -1;
+    }
+    if(input->cols != nn->as[0]->cols){
+        printf("Error: input does not match the network architecture.\n");
+        return -1;
+    }
+    if(__mx_nn_load_rows(nn, input, 0, input->rows) != 0){
+        return -1;
+    }
+    mx_nn_forward(nn);
+    return 0;
 }
 
-float mx_length(const Matrix* matrix) {
-    if (matrix == NULL) {
-        errno = EINVAL;
-        perror("ERROR when 'mx_length': Matrix is NULL.\n");
+static int8_t __mx_nn_check_data(const NN* nn, const Matrix* ti, const Matrix* to){
+    if(CHECK_MATRIX_VALIDITY(ti) == -1 || CHECK_MATRIX_VALIDITY(to) == -1){
+        return -1;
+    }
+    if(ti->rows != to->rows || ti->cols != nn->as[0]->cols || to->cols != nn->as[nn->count]->cols){
+        printf("Error: training data does not match the network architecture.\n");
         return -1;
     }
+    return 0;
+}
 
-    float value = 0;
-    for(size_t i = 0; i < matrix->rows; ++i) {
-        for(size_t j = 0; j < matrix->cols; ++j) {
-            float element = AT(matrix, i, j);
-            value += element * element;  // sum of squares of elements
+float mx_nn_cost(NN* nn, const Matrix* ti, const Matrix* to){
+    if(__mx_nn_check_data(nn, ti, to) == -1){
+        return -1;
+    }
+    size_t n = ti->rows;
+    precision_type cost = 0;
+    for(size_t start = 0; start < n; start += MX_NN_BATCH){
+        size_t count = n - start < MX_NN_BATCH ? n - start : MX_NN_BATCH;
+        if(__mx_nn_load_rows(nn, ti, start, count) != 0){
+            return -1;
+        }
+        mx_nn_forward(nn);
+        const Matrix* out = nn->as[nn->count];
+        for(size_t i = 0; i < count; ++i){
+            for(size_t j = 0; j < to->cols; ++j){
+                precision_type d = AT(out, i, j) - AT(to, start + i, j);
+                cost += d*d;
+            }
         }
     }
-    return sqrt(value);
+    return cost/n;
 }
-uint8_t mx_inverse(Matrix *input, Matrix *output) {
-    if (input->rows != input->cols) return -1;
 
-    int n = input->rows;
-    Matrix* identity = MATRIX_IDENTITY(n);
-
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < n; j++) {
-            AT(output, i, j) = AT(identity, i, j);
+uint8_t mx_nn_backprop(NN* nn, NN* grad, const Matrix* ti, const Matrix* to){
+    if(__mx_nn_check_data(nn, ti, to) == -1){
+        return -1;
+    }
+    if(grad->count != nn->count){
+        printf("Error: gradient network has a different architecture.\n");
+        return -1;
+    }
+    for(size_t l = 0; l <= nn->count; ++l){
+        if(grad->as[l]->cols != nn->as[l]->cols){
+            printf("Error: gradient network has a different architecture.\n");
+            return -1;
         }
     }
-    mx_free(identity); 
 
-    for (int i = 0; i < n; ++i) {
-        float diagValue = AT(input,i,i);
-        if (fabs(diagValue) < 1e-6) return -1; // Singular matrix (or close to singular)
-        for (int j = 0; j < n; j++) {
-            AT(input,i,j) /= diagValue;
-            AT(output,i,j) /= diagValue;
+    for(size_t l = 0; l < grad->count; ++l){
+        __mx_set_zero(grad->ws[l]);
+        __mx_set_zero(grad->bs[l]);
+    }
+
+    size_t n = ti->rows;
+    for(size_t start = 0; start < n; start += MX_NN_BATCH){
+        size_t count = n - start < MX_NN_BATCH ? n - start : MX_NN_BATCH;
+        if(__mx_nn_load_rows(nn, ti, start, count) != 0 || mx_nn_set_batch(grad, count) != 0){
+            return -1;
         }
+        mx_nn_forward(nn);
 
-        for (int j = 0; j < n; ++j) {
-            if (j != i) {
-                float ratio = AT(input,j,i);
-                for (int k = 0; k < n; k++) {
-                    AT(input,j,k) -= ratio * AT(input,i,k);
-                    AT(output,j,k) -= ratio * AT(output,i,k);
-                }
+        // grad->as[l] holds dC/da for layer l, one row per sample, starting from the squared error
+        Matrix* out = nn->as[nn->count];
+        Matrix* dout = grad->as[nn->count];
+        for(size_t i = 0; i < out->rows; ++i){
+            for(size_t j = 0; j < out->cols; ++j){
+                AT(dout, i, j) = 2*(AT(out, i, j) - AT(to, start + i, j));
             }
         }
-    }
-    return 1;
-}
 
-// fast dot algorithm
-void mx_fast_dot(const Matrix *src, const Matrix *dst1, const Matrix *dst2) {
-    for (size_t i = 0; i < dst1->rows; ++i) {
-        for (size_t j = 0; j < dst2->cols; ++j) {
+        for(size_t l = nn->count; l > 0; --l){
+            const Matrix* a = nn->as[l];
+            Matrix* da = grad->as[l];
+            Matrix* db = grad->bs[l-1];
+            precision_type* bias = &AT(db, 0, 0);
+            size_t bias_stride = db->rows == 1 ? db->col_stride : db->row_stride;
 
-            // Loop unrolling for innermost loop
-            size_t k;
-            float sum = 0;
-            for (k = 0; k + 3 < dst1->cols; k += 4) {
-                sum += AT(dst1, i, k) * AT(dst2, k, j)
-                     + AT(dst1, i, k+1) * AT(dst2, k+1, j)
-                     + AT(dst1, i, k+2) * AT(dst2, k+2, j)
-                     + AT(dst1, i, k+3) * AT(dst2, k+3, j);
+            // dC/dz through the sigmoid, stored in place of dC/da; db sums it over the rows
+            for(size_t i = 0; i < a->rows; ++i){
+                for(size_t j = 0; j < a->cols; ++j){
+                    precision_type q = AT(a, i, j);
+                    AT(da, i, j) *= q*(1 - q);
+                    bias[j * bias_stride] += AT(da, i, j);
+                }
             }
 
-            // Handling remaining columns if `dst1->cols` is not a multiple of 4
-            for (; k < dst1->cols; ++k) {
-                sum += AT(dst1, i, k) * AT(dst2, k, j);
+            // dW += prev^T * dZ, dprev = dZ * W^T, one GEMM each over all rows
+            Matrix prev_t = __mx_transposed(nn->as[l-1]);
+            __mx_dot(grad->ws[l-1], &prev_t, da, 1, 1, NULL);
+            if(l > 1){
+                Matrix w_t = __mx_transposed(nn->ws[l-1]);
+                __mx_dot(grad->as[l-1], da, &w_t, 1, 0, NULL);
             }
-
-            AT(src, i, j) = sum;
         }
     }
+
+    for(size_t l = 0; l < grad->count; ++l){
+        mx_apply_op(grad->ws[l], grad->ws[l], NULL, MX_OP_SCALE, 1.0f/n, 0);
+        mx_apply_op(grad->bs[l], grad->bs[l], NULL, MX_OP_SCALE, 1.0f/n, 0);
+    }
+    return 0;
+}
+
+void mx_nn_learn(NN* nn, const NN* grad, float rate){
+    for(size_t l = 0; l < nn->count; ++l){
+        AXPY(nn->ws[l], -rate, grad->ws[l]);
+        AXPY(nn->bs[l], -rate, grad->bs[l]);
+    }
 }
 
 Matrix* mx_dot_new(const Matrix* matrix1, const Matrix* matrix2, float scalar, uint8_t flags){
 
-    Matrix* m1_copy;
-    Matrix* m2_copy;
-    if(CHECK_FLAG(flags,0)){
-        if(CHECK_MATRIX_VALIDITY(matrix1) == -1 || CHECK_MATRIX_VALIDITY(matrix2) == -1){
+    if(!CHECK_FLAG(flags,0)){
+        if(!CHECK_FLAG(flags,1)){
+            errno = EINVAL;
+            perror("ERROR when 'mx_dot': Unspecified flags.");
             return NULL;
-        }   
-        m1_copy = MATRIX_COPY(matrix1);
-        m2_copy = MATRIX_COPY(matrix2);
-    }
-    else if(CHECK_FLAG(flags,1)){
-    // it's a vector-scalar multiplication
+        }
+        // multiplying by a diagonal of `scalar` is scaling
         if(CHECK_MATRIX_VALIDITY(matrix1) == -1){
             return NULL;
-        }  
-        m1_copy = MATRIX_COPY(matrix1);
-        m2_copy = MATRIX_DIAGONAL(matrix1->cols, scalar);
-        
+        }
+        Matrix* result = MATRIX(matrix1->rows, matrix1->cols);
+        if (!result) {
+            errno = ENOMEM;
+            perror("ERROR when 'mx_dot': Unable to allocate memory for result matrix.");
+            return NULL;
+        }
+        mx_apply_op(result, matrix1, NULL, MX_OP_SCALE, scalar, 0);
+        return result;
     }
-    else{
-        errno = EINVAL;
-        perror("ERROR when 'mx_dot': Unspecified flags.");
+    if(CHECK_MATRIX_VALIDITY(matrix1) == -1 || CHECK_MATRIX_VALIDITY(matrix2) == -1){
         return NULL;
     }
-    if(m1_copy->cols != m2_copy->rows){
-        if (m1_copy->cols == m2_copy->cols) {
-            TRANSPOSE(m2_copy);
+
+    // the operands are only read and the result is new, so transposed headers replace the copies
+    Matrix m1 = *matrix1;
+    Matrix m2 = *matrix2;
+    if(m1.cols != m2.rows){
+        if (m1.cols == m2.cols) {
+            m2 = __mx_transposed(matrix2);
         }
-        else if(m1_copy->rows == m2_copy->rows){
-            TRANSPOSE(m1_copy);
+        else if(m1.rows == m2.rows){
+            m1 = __mx_transposed(matrix1);
         }
         else {
             errno = EINVAL;
             perror("ERROR when 'mx_dot': Matrices are not compatible for dot product.");
-            mx_free((Matrix*) m1_copy);
-            mx_free((Matrix*) m2_copy);
             return NULL;
         }
     }
-    Matrix* result = MATRIX(m1_copy->rows, m2_copy->cols);
+    Matrix* result = MATRIX(m1.rows, m2.cols);
     if (!result) {
-        mx_free((Matrix*) m1_copy);
-        mx_free((Matrix*) m2_copy);
-        errno = EINVAL;
+        errno = ENOMEM;
         perror("ERROR when 'mx_dot': Unable to allocate memory for result matrix.");
         return NULL;
     }
-    for(size_t i = 0; i < m1_copy->rows; ++i){
-        for(size_t j = 0; j < m2_copy->cols; ++j){            
-            float sum = 0;
-            for(size_t k = 0; k < m1_copy->cols; k++){
-                sum += AT(m1_copy, i, k) * AT(m2_copy, k, j);
-            }
-            AT(result, i, j) = sum;
-        }
-    }
-
-    mx_free((Matrix*) m1_copy);
-    mx_free((Matrix*) m2_copy);
+    __mx_dot(result, &m1, &m2, 1, 0, NULL);
     return result;
 }
 
@@ -672,24 +3592,11 @@ float mx_self_dot_product(Matrix* vector) {
         return -1; // or any other error value or behavior
     }
 
-    float result = 0;
-    size_t length = (vector->rows == 1) ? vector->cols : vector->rows;
-
-    for (size_t i = 0; i < length; ++i) {
-        float value = (vector->rows == 1) ? AT(vector, 0, i) : AT(vector, i, 0);
-        result += value * value;
-    }
-
-    return result;
+    return __mx_reduce(vector, 1);
 }
 
 float mx_average(const Matrix* src){
-    float average = 0;
-    for(size_t i = 0; i < src->rows; ++i){
-        for(size_t j = 0; j < src->cols; ++j){
-            average += AT(src, i,j);
-        }
-    }
+    float average = __mx_reduce(src, 0);
     return average/(src->rows+src->cols);
 }
 
@@ -706,12 +3613,36 @@ Matrix* mx_slice(const Matrix* src, size_t start_row, size_t end_row, size_t sta
         return NULL;  // Return NULL if the requested slice is invalid
     }
 
+    Matrix* slice = MATRIX_VIEW(src);
+    if (!slice) {
+        printf("ERROR when 'mx_slice': Unable to allocate memory for slice matrix.\n");
+        return NULL;
+    }
+    slice->rows = end_row - start_row + 1;
+    slice->cols = end_col - start_col + 1;
+    slice->offset = src->offset + start_row * src->row_stride + start_col * src->col_stride;
+    return slice;
+}
+
+Matrix* mx_slice_copy(const Matrix* src, size_t start_row, size_t end_row, size_t start_col, size_t end_col) {
+
+    if(CHECK_MATRIX_VALIDITY(src)==-1){
+        return NULL;
+    }
+    
+    // Check for valid indices
+    if (start_row > end_row || start_col > end_col || 
+        end_row >= src->rows || end_col >= src->cols) {
+        printf("ERROR when 'mx_slice_copy': Invalid slice indices.\n");
+        return NULL;  // Return NULL if the requested slice is invalid
+    }
+
     size_t rows = end_row - start_row + 1;
     size_t cols = end_col - start_col + 1;
 
     Matrix* slice = MATRIX(rows,cols);
     if (!slice) {
-        printf("ERROR when 'mx_slice': Unable to allocate memory for slice matrix.\n");
+        printf("ERROR when 'mx_slice_copy': Unable to allocate memory for slice matrix.\n");
         return NULL;
     }
 
@@ -725,64 +3656,448 @@ Matrix* mx_slice(const Matrix* src, size_t start_row, size_t end_row, size_t sta
     return slice;
 }
 
-Matrix* open_dataset(const char* name){
-    FILE* fp = fopen(name,"r");
-    if(fp == NULL){
-        printf("ERROR: Incorrect filename");
+// Dataset loading. The file is mapped once; rows are counted with memchr and
+// each field goes through __mx_parse_float, which only falls back to strtod
+// for values that cannot be rounded exactly in float/double arithmetic.
+static const double __mx_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static inline uint8_t __mx_csv_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char* __mx_parse_float_slow(const char* p, const char* end, precision_type* out) {
+    const char* token_end = p;
+    while (token_end < end && *token_end != ',' && *token_end != '\n' && !__mx_csv_space(*token_end)) {
+        ++token_end;
+    }
+    size_t length = (size_t)(token_end - p);
+    char buffer[128];
+    char* token = length < sizeof(buffer) ? buffer : MX_MALLOC(length + 1);
+    if (!token || length == 0) {
         return NULL;
     }
-    char line[256];
+    memcpy(token, p, length);
+    token[length] = '\0';
+    char* parsed;
+    double value = strtod(token, &parsed);
+    uint8_t complete = parsed == token + length;
+    if (token != buffer) {
+        MX_FREE(token);
+    }
+    if (!complete) {
+        return NULL;
+    }
+    *out = (precision_type)value;
+    return token_end;
+}
+
+// Returns the first character after the number, or NULL if p does not start with one.
+static const char* __mx_parse_float(const char* p, const char* end, precision_type* out) {
+    const char* start = p;
+    uint8_t negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p++ == '-';
+    }
 
-    size_t data_set_rows = 0;
-    size_t data_set_cols = 0;
-    
-    if(!fgets(line, sizeof(line), fp)){
-        printf("ERROR: Something went wrong during file reading.");
-        fclose(fp); // Close the file before returning
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    uint8_t any = 0, truncated = 0;
+    for (; p < end && (unsigned)(*p - '0') < 10; ++p) {
+        any = 1;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            digits += mantissa != 0;
+        } else {
+            exponent++;
+            truncated |= *p != '0';
+        }
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && (unsigned)(*p - '0') < 10; ++p) {
+            any = 1;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            } else {
+                truncated |= *p != '0';
+            }
+        }
+    }
+    if (!any) {
+        return __mx_parse_float_slow(start, end, out);   // inf, nan, hex floats
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* e = p + 1;
+        uint8_t exp_negative = 0;
+        if (e < end && (*e == '-' || *e == '+')) {
+            exp_negative = *e++ == '-';
+        }
+        if (e >= end || (unsigned)(*e - '0') >= 10) {
+            return NULL;
+        }
+        int value = 0;
+        for (; e < end && (unsigned)(*e - '0') < 10; ++e) {
+            if (value < 100000) {
+                value = value * 10 + (*e - '0');
+            }
+        }
+        exponent += exp_negative ? -value : value;
+        p = e;
+    }
+
+    // Clinger's fast path: both operands are exact, so one rounding gives the correctly rounded result
+    precision_type value;
+    if (truncated) {
+        return __mx_parse_float_slow(start, end, out);
+    } else if (mantissa == 0) {
+        value = 0;
+    } else if (sizeof(precision_type) == sizeof(float) && mantissa <= (1u << 24) && exponent >= -10 && exponent <= 10) {
+        float m = (float)mantissa, scale = (float)__mx_pow10[exponent < 0 ? -exponent : exponent];
+        value = exponent < 0 ? m / scale : m * scale;
+    } else if (mantissa <= (UINT64_C(1) << 53) && exponent >= -22 && exponent <= 22) {
+        double m = (double)mantissa;
+        value = (precision_type)(exponent < 0 ? m / __mx_pow10[-exponent] : m * __mx_pow10[exponent]);
+    } else {
+        return __mx_parse_float_slow(start, end, out);
+    }
+    *out = negative ? -value : value;
+    return p;
+}
+
+static uint8_t __mx_csv_blank(const char* line, const char* eol) {
+    while (line < eol && __mx_csv_space(*line)) {
+        ++line;
+    }
+    return line == eol;
+}
+
+static const char* __mx_csv_eol(const char* p, const char* end) {
+    const char* eol = memchr(p, '\n', (size_t)(end - p));
+    return eol ? eol : end;
+}
+
+// Parses one line into cols values; returns 0 if it does not hold exactly cols numbers.
+static uint8_t __mx_csv_parse_row(const char* p, const char* eol, precision_type* out, size_t cols) {
+    for (size_t j = 0; j < cols; ++j) {
+        while (p < eol && __mx_csv_space(*p)) {
+            ++p;
+        }
+        p = __mx_parse_float(p, eol, &out[j]);
+        if (!p) {
+            return 0;
+        }
+        while (p < eol && __mx_csv_space(*p)) {
+            ++p;
+        }
+        if (j + 1 < cols) {
+            if (p == eol || *p != ',') {
+                return 0;
+            }
+            ++p;
+        }
+    }
+    return p == eol;
+}
+
+typedef struct {
+    const char* begin;
+    const char* end;
+    size_t first_row;
+    size_t rows;
+    size_t bad_row;         // SIZE_MAX when every row parsed
+} __mx_csv_chunk;
+
+typedef struct {
+    __mx_csv_chunk* chunks;
+    Matrix* result;
+} __mx_csv_args;
+
+static void __mx_csv_count_task(size_t start, size_t end, void* arg) {
+    __mx_csv_chunk* chunks = ((__mx_csv_args*)arg)->chunks;
+    for (size_t c = start; c < end; ++c) {
+        size_t rows = 0;
+        for (const char* p = chunks[c].begin; p < chunks[c].end;) {
+            const char* eol = __mx_csv_eol(p, chunks[c].end);
+            rows += !__mx_csv_blank(p, eol);
+            p = eol < chunks[c].end ? eol + 1 : chunks[c].end;
+        }
+        chunks[c].rows = rows;
+    }
+}
+
+static void __mx_csv_parse_task(size_t start, size_t end, void* arg) {
+    __mx_csv_args* args = arg;
+    Matrix* result = args->result;
+    for (size_t c = start; c < end; ++c) {
+        __mx_csv_chunk* chunk = &args->chunks[c];
+        size_t row = chunk->first_row;
+        chunk->bad_row = SIZE_MAX;
+        for (const char* p = chunk->begin; p < chunk->end;) {
+            const char* eol = __mx_csv_eol(p, chunk->end);
+            if (!__mx_csv_blank(p, eol)) {
+                if (!__mx_csv_parse_row(p, eol, &AT(result, row, 0), result->cols)) {
+                    chunk->bad_row = row;
+                    break;
+                }
+                ++row;
+            }
+            p = eol < chunk->end ? eol + 1 : chunk->end;
+        }
+    }
+}
+
+static Matrix* __mx_csv_parse(const char* data, size_t size) {
+    const char* end = data + size;
+
+    // the first non-blank line sets the number of columns
+    const char* line = data;
+    const char* eol = __mx_csv_eol(line, end);
+    while (__mx_csv_blank(line, eol) && eol < end) {
+        line = eol + 1;
+        eol = __mx_csv_eol(line, end);
+    }
+    if (__mx_csv_blank(line, eol)) {
+        printf("ERROR when 'open_dataset': File has no data.\n");
         return NULL;
     }
-    data_set_rows++;
-    
-    char* token = strtok(line, ",");
+    size_t cols = 1;
+    for (const char* p = line; (p = memchr(p, ',', (size_t)(eol - p))); ++p) {
+        cols++;
+    }
 
-    while (token) {
-        token = strtok(NULL, ",");
-        data_set_cols++;
+    // chunk boundaries are moved forward to the start of a line
+    size_t threads = mx_get_num_threads();
+    size_t count = size / MX_CSV_CHUNK;
+    if (count > threads * 4) {
+        count = threads * 4;
+    }
+    if (count < 2 || threads < 2) {
+        count = 1;
+    }
+    __mx_csv_chunk* chunks = MX_MALLOC(sizeof(*chunks) * count);
+    if (!chunks) {
+        printf("ERROR when 'open_dataset': Unable to allocate memory.\n");
+        return NULL;
+    }
+    const char* begin = data;
+    for (size_t c = 0; c < count; ++c) {
+        const char* chunk_end = c + 1 == count ? end : data + size / count * (c + 1);
+        if (chunk_end < begin) {
+            chunk_end = begin;
+        }
+        if (chunk_end < end && chunk_end > data && chunk_end[-1] != '\n') {
+            chunk_end = __mx_csv_eol(chunk_end, end);
+            chunk_end += chunk_end < end;
+        }
+        chunks[c].begin = begin;
+        chunks[c].end = chunk_end;
+        begin = chunk_end;
     }
-    while(fgets(line, sizeof(line), fp)) {data_set_rows++;};
 
-    fclose(fp);
+    __mx_csv_args args = {chunks, NULL};
+    mx_parallel_for(count, 1, __mx_csv_count_task, &args);
+    size_t rows = 0;
+    for (size_t c = 0; c < count; ++c) {
+        chunks[c].first_row = rows;
+        rows += chunks[c].rows;
+    }
 
-    fp = fopen(name,"r");
-    if(fp == NULL){
-        printf("ERROR: Couldn't reopen the file.");
+    Matrix* result = MATRIX(rows, cols);
+    if (!result) {
+        printf("ERROR when 'open_dataset': Unable to allocate memory.\n");
+        MX_FREE(chunks);
         return NULL;
     }
-    
-    Matrix* result = MATRIX(data_set_rows, data_set_cols);
-
-    size_t i = 0;
-    while (fgets(line, sizeof(line), fp)) {
-        size_t j = 0;
-        char* token = strtok(line, ",");
-        while (token) {
-            float value = atof(token);
-            if (i < data_set_rows && j < data_set_cols) {
-                AT(result, i, j) = value;
-            } else {
-                printf("ERROR: Trying to access out-of-bounds index. i: %zu, j: %zu\n", i, j);
-            }
-            ++j;
-            token = strtok(NULL, ",");
+    args.result = result;
+    mx_parallel_for(count, 1, __mx_csv_parse_task, &args);
+    for (size_t c = 0; c < count; ++c) {
+        if (chunks[c].bad_row != SIZE_MAX) {
+            printf("ERROR when 'open_dataset': Row %zu does not hold %zu numbers.\n", chunks[c].bad_row, cols);
+            mx_free(result);
+            result = NULL;
+            break;
         }
-        ++i;
     }
-    
-    fclose(fp);
+    MX_FREE(chunks);
+    return result;
+}
 
+Matrix* open_dataset(const char* name){
+    int fd = open(name, O_RDONLY);
+    if(fd == -1){
+        perror("ERROR when 'open_dataset'");
+        return NULL;
+    }
+    struct stat st;
+    if(fstat(fd, &st) == -1){
+        perror("ERROR when 'open_dataset'");
+        close(fd);
+        return NULL;
+    }
+    if(st.st_size == 0){
+        printf("ERROR when 'open_dataset': File is empty.\n");
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED){
+        perror("ERROR when 'open_dataset'");
+        return NULL;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    Matrix* result = __mx_csv_parse(data, size);
+    munmap(data, size);
     return result;
 }
 
+// .mxb files: a fixed header followed by the raw elements, see mx_save in mx.h
+#define MX_MXB_BYTE_ORDER 0x01020304u
+
+typedef struct {
+    char magic[4];
+    uint32_t byte_order;
+    uint32_t element_size;
+    uint32_t alignment;
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t row_stride;
+    uint64_t col_stride;
+    uint64_t data_offset;
+    uint64_t count;
+} __mx_mxb_header;
+
+typedef struct {
+    void* base;
+    size_t length;
+} __mx_mapping;
+
+static void __mx_mapping_release(precision_type* data, void* ctx) {
+    (void)data;
+    __mx_mapping* mapping = ctx;
+    munmap(mapping->base, mapping->length);
+    MX_FREE(mapping);
+}
+
+uint8_t mx_save(const Matrix* matrix, const char* name) {
+    if (CHECK_MATRIX_VALIDITY(matrix) == -1) {
+        return -1;
+    }
+    uint8_t compact = __mx_compact(matrix);
+    __mx_mxb_header header = {
+        .magic = {'M', 'X', 'B', '1'},
+        .byte_order = MX_MXB_BYTE_ORDER,
+        .element_size = sizeof(precision_type),
+        .alignment = MX_ALIGN_MXB,
+        .rows = matrix->rows,
+        .cols = matrix->cols,
+        .row_stride = compact ? matrix->row_stride : matrix->cols,
+        .col_stride = compact ? matrix->col_stride : 1,
+        .data_offset = (sizeof(__mx_mxb_header) + MX_ALIGN_MXB - 1) / MX_ALIGN_MXB * MX_ALIGN_MXB,
+        .count = matrix->rows * matrix->cols,
+    };
+
+    FILE* fp = fopen(name, "wb");
+    if (!fp) {
+        perror("ERROR when 'mx_save'");
+        return -1;
+    }
+    static const char padding[MX_ALIGN_MXB];
+    size_t pad = header.data_offset - sizeof(header);
+    uint8_t ok = fwrite(&header, sizeof(header), 1, fp) == 1 && fwrite(padding, 1, pad, fp) == pad;
+    if (compact) {
+        ok = ok && fwrite(&AT(matrix, 0, 0), sizeof(precision_type), header.count, fp) == header.count;
+    } else if (matrix->col_stride == 1) {
+        for (size_t i = 0; ok && i < matrix->rows; ++i) {
+            ok = fwrite(&AT(matrix, i, 0), sizeof(precision_type), matrix->cols, fp) == matrix->cols;
+        }
+    } else {
+        for (size_t i = 0; ok && i < matrix->rows; ++i) {
+            for (size_t j = 0; ok && j < matrix->cols; ++j) {
+                ok = fwrite(&AT(matrix, i, j), sizeof(precision_type), 1, fp) == 1;
+            }
+        }
+    }
+    if (fclose(fp) != 0 || !ok) {
+        perror("ERROR when 'mx_save'");
+        return -1;
+    }
+    return 0;
+}
+
+Matrix* mx_load(const char* name) {
+    int fd = open(name, O_RDONLY);
+    if (fd == -1) {
+        perror("ERROR when 'mx_load'");
+        return NULL;
+    }
+    struct stat st;
+    __mx_mxb_header header;
+    if (fstat(fd, &st) == -1 || read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+        printf("ERROR when 'mx_load': Unable to read the header of '%s'.\n", name);
+        close(fd);
+        return NULL;
+    }
+    size_t file_size = (size_t)st.st_size;
+
+    const char* error = NULL;
+    if (memcmp(header.magic, "MXB1", 4) != 0) {
+        error = "Not an .mxb file";
+    } else if (header.byte_order != MX_MXB_BYTE_ORDER) {
+        error = "File was saved with a different byte order";
+    } else if (header.element_size != sizeof(precision_type)) {
+        error = "File was saved with a different precision";
+    } else if (header.alignment == 0 || (header.alignment & (header.alignment - 1)) ||
+               header.data_offset % header.alignment || header.data_offset < sizeof(header) ||
+               header.data_offset > file_size) {
+        error = "Corrupt header";
+    } else if (!VALID_DIMENSIONS(header.rows, header.cols) || header.count == 0 ||
+               header.count > (file_size - header.data_offset) / sizeof(precision_type)) {
+        error = "File is truncated or has invalid dimensions";
+    } else if ((header.rows > 1 && header.row_stride > (header.count - 1) / (header.rows - 1)) ||
+               (header.cols > 1 && header.col_stride > (header.count - 1) / (header.cols - 1)) ||
+               (header.rows - 1) * header.row_stride + (header.cols - 1) * header.col_stride >= header.count) {
+        error = "Strides reach past the stored elements";
+    }
+    if (error) {
+        printf("ERROR when 'mx_load': %s.\n", error);
+        close(fd);
+        return NULL;
+    }
+
+    // copy-on-write, so the matrix stays writable without touching the file
+    void* base = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("ERROR when 'mx_load'");
+        return NULL;
+    }
+    __mx_mapping* mapping = MX_MALLOC(sizeof(__mx_mapping));
+    Matrix* matrix = NULL;
+    if (mapping) {
+        mapping->base = base;
+        mapping->length = file_size;
+        matrix = mx_wrap((precision_type*)((char*)base + header.data_offset), header.rows, header.cols,
+                         __mx_mapping_release, mapping);
+    }
+    if (!matrix) {
+        printf("ERROR when 'mx_load': Unable to allocate memory.\n");
+        MX_FREE(mapping);
+        munmap(base, file_size);
+        return NULL;
+    }
+    matrix->container->size = header.count;
+    matrix->row_stride = header.row_stride;
+    matrix->col_stride = header.col_stride;
+    return matrix;
+}
+
 uint8_t mx_print(const Matrix* matrix, const char* name, size_t padding) {
     if(CHECK_MATRIX_VALIDITY(matrix)==-1){
         return -1;
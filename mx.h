@@ -25,7 +25,97 @@
 #endif
 
 #ifndef THREAD_COUNT
-#define THREAD_COUNT 8 
+#define THREAD_COUNT 8
+#endif
+
+// GEMM cache blocking: KC x NC panel of B stays in L3, MC x KC block of A in L2
+#ifndef MX_GEMM_MC
+#define MX_GEMM_MC 96
+#endif
+
+#ifndef MX_GEMM_KC
+#define MX_GEMM_KC 256
+#endif
+
+#ifndef MX_GEMM_NC
+#define MX_GEMM_NC 4096
+#endif
+
+// DOT splits the rows of the result across the thread pool once m*n*k reaches this size
+#ifndef MX_THREAD_THRESHOLD
+#define MX_THREAD_THRESHOLD (64 * 64 * 64)
+#endif
+
+// elements per task for elementwise kernels and reductions run on the thread pool
+#ifndef MX_PARALLEL_GRAIN
+#define MX_PARALLEL_GRAIN (1 << 15)
+#endif
+
+// below m*n*k of this size packing costs more than it saves
+#ifndef MX_GEMM_SMALL
+#define MX_GEMM_SMALL (32 * 32 * 32)
+#endif
+
+// rows of the result per task in matrix-vector products
+#ifndef MX_GEMV_BLOCK
+#define MX_GEMV_BLOCK 1024
+#endif
+
+// panel width of the blocked LU and Cholesky factorizations
+#ifndef MX_LU_BLOCK
+#define MX_LU_BLOCK 64
+#endif
+
+// size of the triangles that mx_trsm and mx_trmm handle by substitution rather than halving
+#ifndef MX_TRSM_LEAF
+#define MX_TRSM_LEAF 32
+#endif
+
+// panel width of the blocked Householder QR, see mx_qr
+#ifndef MX_QR_BLOCK
+#define MX_QR_BLOCK 32
+#endif
+
+// oversampling and power iterations of the randomized range finder, see mx_svd_truncated
+#ifndef MX_SVD_OVERSAMPLING
+#define MX_SVD_OVERSAMPLING 10
+#endif
+#ifndef MX_SVD_POWER_ITERATIONS
+#define MX_SVD_POWER_ITERATIONS 2
+#endif
+
+// rows per batch when mx_nn_cost and mx_nn_backprop walk a dataset
+#ifndef MX_NN_BATCH
+#define MX_NN_BATCH 256
+#endif
+
+// alignment of the element data inside .mxb files
+#ifndef MX_ALIGN_MXB
+#define MX_ALIGN_MXB 64
+#endif
+
+// open_dataset parses files at least this large in chunks on the thread pool
+#ifndef MX_CSV_CHUNK
+#define MX_CSV_CHUNK (1 << 20)
+#endif
+
+// default size of the blocks an mx_arena takes from MX_MALLOC
+#ifndef MX_ARENA_BLOCK
+#define MX_ARENA_BLOCK (1 << 20)
+#endif
+
+// how deep arena scopes can nest on one thread
+#ifndef MX_ARENA_DEPTH
+#define MX_ARENA_DEPTH 16
+#endif
+
+// number of distinct buffer sizes the buffer pool keeps, a power of two; see mx_buffer_pool_enable
+#ifndef MX_BUFFER_POOL_BUCKETS
+#define MX_BUFFER_POOL_BUCKETS 64
+#endif
+// number of buffers of one size the buffer pool keeps
+#ifndef MX_BUFFER_POOL_DEPTH
+#define MX_BUFFER_POOL_DEPTH 16
 #endif
 
 #ifndef MX_MALLOC
@@ -39,14 +129,18 @@
     ((matrix) && (matrix)->container && (matrix)->container->data && VALID_DIMENSIONS((matrix)->rows, (matrix)->cols))
 #define CHECK_MATRIX_VALIDITY(matrix) matrix_is_valid(matrix)
 #define AT(matrix, i, j) \
-    (matrix)->container->data[(i) * (matrix)->row_stride + (j) * (matrix)->col_stride]
+    (matrix)->container->data[(matrix)->offset + (i) * (matrix)->row_stride + (j) * (matrix)->col_stride]
 /**
  * @brief Allocates a matrix with rows and cols size. 
- * also allocates a memory for matrix container with size rows x cols
+ * The header, the container and the data share one allocation; the data is
+ * aligned to 64 bytes.
 */
 #define MATRIX(rows, cols) __mx_init(NULL,rows, cols, 0)
 #define MATRIX_FROM(array,rows,cols) __mx_init(array, rows,cols, 0)
 #define MATRIX_FROM_ARRAY(array) MATRIX_FROM(array, ARRAY_ROWS(array), ARRAY_COLS(array))
+// borrows a caller-owned row-major buffer instead of copying it, see mx_wrap
+#define MATRIX_WRAP(data, rows, cols) mx_wrap(data, rows, cols, NULL, NULL)
+#define MATRIX_PADDED(rows, cols) mx_padded_new(rows, cols)
 #define MATRIX_VIEW(matrix) safe_mx_view(matrix)
 #define MATRIX_ONES(rows,cols)  \
     ((rows) <= 0 || (cols) <= 0) ? \
@@ -116,6 +210,8 @@
 
 #define ROW_SLICE(matrix,i,j) mx_slice(matrix,i,j,0,(matrix)->cols-1)
 #define COL_SLICE(matrix,i,j) mx_slice(matrix, 0, (matrix)->rows-1, i, j)
+#define ROW_SLICE_COPY(matrix,i,j) mx_slice_copy(matrix,i,j,0,(matrix)->cols-1)
+#define COL_SLICE_COPY(matrix,i,j) mx_slice_copy(matrix, 0, (matrix)->rows-1, i, j)
 
 #define UNIT_VECTOR_FROM(matrix) mx_unit_vector_from(matrix)
 #define UNIT_VECTOR(size) mx_identity_new(size)
@@ -143,10 +239,15 @@
  */
 #define DOT(src, dst1, dst2) mx_fast_dot(src, dst1, dst2)
 #define SCALAR_DOT(matrix, scalar_value) mx_dot_new(matrix, NULL, scalar_value, 1U<<1)
-#define ADD(matrix1, matrix2) APPLY_TO_BOTH(matrix1,matrix2, __add_elements)
-#define ADD_NEW(matrix1, matrix2) APPLY_TO_BOTH_NEW(matrix1,matrix2, __add_elements)
-#define SUBTRACT(matrix1,matrix2) APPLY_TO_BOTH_INPLACE(matrix1, matrix2, __subtract_elements)
-#define SUBTRACT_NEW(matrix1,matrix2) APPLY_TO_BOTH_NEW(matrix1, matrix2, __subtract_elements)
+#define ADD(matrix1, matrix2) mx_apply_op(matrix1, matrix1, matrix2, MX_OP_ADD, 0, 0)
+#define ADD_NEW(matrix1, matrix2) mx_apply_op_new(matrix1, matrix2, MX_OP_ADD, 0, 0)
+#define SUBTRACT(matrix1,matrix2) mx_apply_op(matrix1, matrix1, matrix2, MX_OP_SUB, 0, 0)
+#define SUBTRACT_NEW(matrix1,matrix2) mx_apply_op_new(matrix1, matrix2, MX_OP_SUB, 0, 0)
+#define MULTIPLY(matrix1, matrix2) mx_apply_op(matrix1, matrix1, matrix2, MX_OP_MUL, 0, 0)
+#define DIVIDE(matrix1, matrix2) mx_apply_op(matrix1, matrix1, matrix2, MX_OP_DIV, 0, 0)
+#define AXPY(y, alpha, x) mx_apply_op(y, x, y, MX_OP_AXPY, alpha, 0)
+#define CLAMP(matrix, min, max) mx_apply_op(matrix, matrix, NULL, MX_OP_CLAMP, min, max)
+#define APPLY_OP(matrix, op) mx_apply_op(matrix, matrix, NULL, op, 0, 0)
 
 #define APPLY_TO_BOTH(matrix1, matrix2, function) mx_apply_function_to_both(matrix1, matrix2, function)
 #define APPLY_TO_BOTH_NEW(matrix1, matrix2, function) mx_apply_function_to_both_new(matrix1, matrix2, function)
@@ -160,17 +261,22 @@
 #define PRINTNN(nn) mx_nn_print(nn, #nn)
 
 typedef struct{
-    uint16_t ref_count;
+    size_t ref_count;
     size_t size;
     precision_type *data;
+    void (*release)(precision_type* data, void* ctx);   // frees data instead of MX_FREE when set
+    void* release_ctx;
+    void* block;        // allocation shared with the data and first header, freed with the container
+    size_t block_bytes;
 } __matrix_container;
 
 typedef struct{
     uint8_t flags; // lazy_mat, ...
-    uint16_t rows;
-    uint16_t cols;
-    uint16_t row_stride;
-    uint16_t col_stride;
+    size_t rows;
+    size_t cols;
+    size_t row_stride;
+    size_t col_stride;
+    size_t offset;      // index of element (0,0) in the container, non-zero for slices
     precision_type default_value;
     __matrix_container *container;  // Points to the original matrix
 } Matrix;
@@ -203,10 +309,155 @@ typedef struct {
 
     Matrix** as;        /**< Pointer to an array of activation matrices.
                              Each matrix in this array holds the activation values 
-                             for each neuron in a layer, after applying the activation function. */
+                             for each neuron in a layer, after applying the activation function.
+                             There is one row per sample of the current batch (see mx_nn_set_batch). */
 
 } NN;
 
+/**
+ * @brief Task run by mx_parallel_for on the index range [start, end).
+ */
+typedef void (*mx_parallel_fn)(size_t start, size_t end, void* arg);
+
+/**
+ * @brief Runs func over [0, count) on the library thread pool.
+ *
+ * The range is cut into chunks of `grain` indices which the pool threads and the
+ * calling thread take in turn; the call returns once every chunk is done. The pool
+ * is started on first use. Nested calls, calls made while another thread owns the
+ * pool and ranges that fit in one chunk run serially as func(0, count, arg).
+ *
+ * @param count Number of indices.
+ * @param grain Indices per chunk.
+ * @param func  Task invoked for each chunk.
+ * @param arg   Passed through to func.
+ */
+void mx_parallel_for(size_t count, size_t grain, mx_parallel_fn func, void* arg);
+
+/**
+ * @brief Sets the number of threads (including the caller) used by the thread pool.
+ *
+ * A running pool is stopped and restarted with the new size on the next parallel call.
+ * Passing 0 restores the default: THREAD_COUNT capped at the number of online CPUs.
+ */
+void mx_set_num_threads(size_t count);
+
+size_t mx_get_num_threads(void);
+
+/**
+ * @brief Joins the pool threads and releases them. Registered with atexit on first use;
+ * the pool is started again lazily if another parallel kernel runs afterwards.
+ */
+void mx_thread_pool_shutdown(void);
+
+/**
+ * @brief Counters of the buffer pool since it was last drained.
+ */
+typedef struct {
+    size_t hits;            /**< allocations served from the pool */
+    size_t misses;          /**< allocations that went to MX_MALLOC while the pool was enabled */
+    size_t cached;          /**< buffers currently held by the pool */
+    size_t cached_bytes;    /**< bytes currently held by the pool */
+} mx_buffer_pool_stats;
+
+/**
+ * @brief Turns the buffer pool on or off. Off by default.
+ *
+ * While enabled, freed matrices and GEMM scratch buffers are kept in free lists
+ * keyed by their exact size (up to MX_BUFFER_POOL_DEPTH per size, for at most
+ * MX_BUFFER_POOL_BUCKETS sizes) and handed out again for the next allocation of
+ * that size, so loops that keep producing the same shapes stop calling MX_MALLOC.
+ * Turning it off drains it. The pool is shared by all threads and drained at exit.
+ */
+void mx_buffer_pool_enable(uint8_t enabled);
+
+/**
+ * @brief Returns the cached buffers to MX_FREE and clears the counters.
+ */
+void mx_buffer_pool_drain(void);
+
+mx_buffer_pool_stats mx_buffer_pool_get_stats(void);
+
+/**
+ * @brief Bump allocator for short-lived matrices.
+ *
+ * While an arena is active on a thread, every matrix created on that thread
+ * (header, container and data) is carved out of the arena's blocks instead of
+ * coming from MX_MALLOC. mx_free on such a matrix is a no-op, and
+ * mx_arena_reset releases all of them at once. Blocks are kept across resets,
+ * so a training step that runs between resets stops allocating once warmed up.
+ */
+typedef struct mx_arena mx_arena;
+
+/**
+ * @brief Creates an arena whose blocks hold block_size bytes (0 for MX_ARENA_BLOCK).
+ * Larger requests get a block of their own.
+ *
+ * @return Pointer to the new arena or NULL if allocation failed.
+ */
+mx_arena* mx_arena_new(size_t block_size);
+
+/**
+ * @brief Routes the matrix allocations of the calling thread to arena until the
+ * matching mx_arena_end.
+ *
+ * Scopes nest up to MX_ARENA_DEPTH deep on each thread, the same arena included;
+ * the innermost one is used. An arena is used by one thread at a time: it can be
+ * begun on another thread only once all of its scopes have ended.
+ *
+ * Matrices created in the scope must not be used after the arena is reset or
+ * freed, and must not be freed after mx_arena_end. Buffers owned by long-lived
+ * objects, such as the activations resized by mx_nn_set_batch, bypass the arena.
+ *
+ * @return 0 on success, -1 if arena is NULL, active on another thread, or the
+ *         scopes of the calling thread are MX_ARENA_DEPTH deep already.
+ */
+uint8_t mx_arena_begin(mx_arena* arena);
+
+/**
+ * @brief Ends the innermost arena scope of the calling thread.
+ */
+void mx_arena_end(void);
+
+/**
+ * @brief Releases every matrix allocated from arena in O(1), keeping its blocks.
+ */
+void mx_arena_reset(mx_arena* arena);
+
+/**
+ * @brief Returns the blocks of arena to MX_FREE. The arena must not be active.
+ */
+void mx_arena_free(mx_arena* arena);
+
+/**
+ * @brief Instruction set the vectorized kernels dispatch to.
+ */
+typedef enum {
+    MX_SIMD_SCALAR = 0,
+    MX_SIMD_SSE,
+    MX_SIMD_AVX2,       /**< AVX2 + FMA. */
+    MX_SIMD_AVX512,     /**< AVX-512F. */
+} mx_simd_level;
+
+/**
+ * @brief Returns the instruction set currently used by DOT, mx_apply_op (ADD, SUBTRACT, ...),
+ * mx_scale, mx_length, mx_self_dot_product and mx_apply_sigmoid.
+ *
+ * The best level the CPU supports is detected on first use. Non-x86 builds and builds
+ * with USE_DOUBLE_PRECISION or MX_NO_SIMD always report MX_SIMD_SCALAR.
+ */
+mx_simd_level mx_get_simd_level(void);
+
+/**
+ * @brief Forces the kernels down to the given level, e.g. to compare results.
+ *
+ * Levels above what the CPU supports are clamped. Should not be called while other
+ * threads are running kernels.
+ *
+ * @return The level actually in use.
+ */
+mx_simd_level mx_set_simd_level(mx_simd_level level);
+
 float sigmoidf(float value);
 float __add_elements(float a, float b);
 float __subtract_elements(float a, float b); 
@@ -239,6 +490,11 @@ Matrix* mx_copy(const Matrix* src);
  * Iterates over each element in the matrix and updates its value 
  * using the provided function.
  *
+ * Matrices of more than MX_PARALLEL_GRAIN elements are split across the thread
+ * pool, so func may run on several threads at once and in no particular order:
+ * it must be thread-safe, e.g. free of shared mutable state. For a stateful
+ * func, call mx_set_num_threads(1) first to keep every call on the caller's thread.
+ *
  * @param matrix Pointer to the Matrix whose elements are to be updated.
  * @param func Pointer to the function that defines the transformation.
  */
@@ -272,12 +528,97 @@ __matrix_container* __init_container(float* array,size_t size);
  */
 Matrix* __mx_init(float* array, size_t rows, size_t cols, float init_value);
 
+/**
+ * @brief Allocates a zeroed matrix whose rows start on 64 byte boundaries.
+ *
+ * row_stride is cols rounded up to a whole number of 64 byte vectors, so every
+ * row starts aligned and SIMD kernels never split a vector across two rows. The
+ * padding elements are zero and are never read as part of the matrix.
+ *
+ * @param rows The number of rows for the matrix.
+ * @param cols The number of columns for the matrix.
+ * @return A pointer to the new matrix or NULL if the dimensions are invalid or
+ *         allocation failed.
+ */
+Matrix* mx_padded_new(size_t rows, size_t cols);
+
+/**
+ * @brief Creates a matrix over an existing row-major buffer without copying it.
+ *
+ * The container points at data itself, so writes through the matrix reach the
+ * buffer and views share it as usual. When the last reference is freed,
+ * release(data, ctx) is called if given; otherwise the buffer is left to the
+ * caller, who must keep it alive while the matrix is in use.
+ *
+ * @param data Buffer holding at least rows x cols elements.
+ * @param rows The number of rows for the matrix.
+ * @param cols The number of columns for the matrix.
+ * @param release Called once with data and ctx when the matrix is freed, or NULL.
+ * @param ctx Passed to release.
+ * @return A pointer to the new matrix or NULL if data is NULL, the dimensions are
+ *         invalid or allocation failed. The buffer is not released on failure.
+ */
+Matrix* mx_wrap(precision_type* data, size_t rows, size_t cols, void (*release)(precision_type* data, void* ctx), void* ctx);
+
 NN* __mx_nn_alloc(size_t* arch, size_t arch_count);
 
 void mx_set_to_rand(Matrix* m, float min, float max);
 
 void mx_nn_set_to_rand(NN* nn, float min, float max);
 
+/**
+ * @brief Runs the network on the samples stored in the rows of nn->as[0]; the outputs
+ * end up in the rows of nn->as[nn->count]. Each layer is one GEMM over the whole batch,
+ * fused with its bias and sigmoid activation.
+ */
+void mx_nn_forward(NN* nn);
+
+/**
+ * @brief Resizes the activation matrices nn->as[i] to batch x N.
+ *
+ * Buffers are kept and only their row count changes when they are already large enough,
+ * so alternating between batch sizes does not reallocate.
+ *
+ * @return 0 on success, -1 on a zero batch or allocation failure. On failure no
+ * activation is changed.
+ */
+uint8_t mx_nn_set_batch(NN* nn, size_t batch);
+
+/**
+ * @brief Forward pass over a batch: input holds one sample per row. The batch size
+ * follows input->rows and the outputs are left in nn->as[nn->count].
+ *
+ * @return 0 on success, -1 if input does not fit the input layer.
+ */
+uint8_t mx_nn_forward_batch(NN* nn, const Matrix* input);
+
+/**
+ * @brief Mean squared error of the network over a dataset, evaluated in batches of
+ * MX_NN_BATCH rows.
+ *
+ * @param ti Inputs, one sample per row, as many columns as the input layer.
+ * @param to Expected outputs, one sample per row, as many columns as the output layer.
+ * @return The cost, or -1 if the data does not fit the network.
+ */
+float mx_nn_cost(NN* nn, const Matrix* ti, const Matrix* to);
+
+/**
+ * @brief Computes the exact gradient of mx_nn_cost by backpropagation.
+ *
+ * The data goes through in batches of MX_NN_BATCH rows, each with one batched forward
+ * and one batched backward pass. The result, averaged over the samples, is written to
+ * grad->ws and grad->bs; grad->as is used as scratch for the per-layer derivatives.
+ * grad must have the same architecture as nn.
+ *
+ * @return 0 on success, -1 if the data or grad do not fit the network.
+ */
+uint8_t mx_nn_backprop(NN* nn, NN* grad, const Matrix* ti, const Matrix* to);
+
+/**
+ * @brief One gradient descent step: every weight and bias moves by -rate * gradient.
+ */
+void mx_nn_learn(NN* nn, const NN* grad, float rate);
+
 /**
  * @brief Creates a view of an existing matrix or initializes a lazy matrix.
  * 
@@ -422,9 +763,69 @@ Matrix* mx_scale(Matrix* matrix, float scalar);
  */
 Matrix* mx_add(Matrix* matrix1, Matrix* matrix2, uint8_t flags);
 
+/**
+ * @brief Sets matrix1 = func(matrix1, matrix2) element-wise.
+ *
+ * Runs func on the thread pool like mx_apply_function, so it must be thread-safe too.
+ *
+ * @return 0 on success, -1 on an invalid matrix or mismatched dimensions.
+ */
 uint8_t mx_apply_function_to_both(Matrix* matrix1,Matrix* matrix2, float (*func)(float, float));
 
+/**
+ * @brief Returns a new matrix holding func(matrix1, matrix2) element-wise.
+ *
+ * Runs func on the thread pool like mx_apply_function, so it must be thread-safe too.
+ *
+ * @return The new matrix, or NULL on an invalid matrix, mismatched dimensions or a failed allocation.
+ */
 Matrix* mx_apply_function_to_both_new(Matrix* matrix1,Matrix* matrix2, float (*func)(float, float));
+
+/**
+ * @brief Built-in elementwise operations, run by vectorized kernels.
+ *
+ * Binary ops read both operands, unary ops only the first one.
+ */
+typedef enum {
+    MX_OP_ADD = 0,      /**< a + b */
+    MX_OP_SUB,          /**< a - b */
+    MX_OP_MUL,          /**< a * b (Hadamard product) */
+    MX_OP_DIV,          /**< a / b */
+    MX_OP_AXPY,         /**< alpha * a + b */
+    MX_OP_SCALE,        /**< alpha * a */
+    MX_OP_CLAMP,        /**< a clamped to [alpha, beta] */
+    MX_OP_SIGMOID,      /**< 1 / (1 + exp(-a)) */
+    MX_OP_TANH,
+    MX_OP_RELU,         /**< max(a, 0) */
+    MX_OP_EXP,
+    MX_OP_LOG,
+    MX_OP_IDENTITY,     /**< a, e.g. a dense layer without activation */
+    MX_OP_COUNT
+} mx_op;
+
+/**
+ * @brief Computes result = op(matrix1, matrix2) elementwise.
+ *
+ * Unlike mx_apply_function there is no call through a pointer per element: each op
+ * has its own kernel for every SIMD level (see mx_get_simd_level). result may be
+ * matrix1 or matrix2 to work in place. matrix2 is ignored by unary ops and can be NULL.
+ *
+ * @param result  Matrix receiving the output, same shape as matrix1.
+ * @param matrix1 First operand.
+ * @param matrix2 Second operand of binary ops, same shape as matrix1.
+ * @param op      Operation to apply.
+ * @param alpha   Scalar operand of MX_OP_AXPY, MX_OP_SCALE and lower bound of MX_OP_CLAMP.
+ * @param beta    Upper bound of MX_OP_CLAMP.
+ * @return 0 on success, -1 on invalid matrices, mismatched shapes or an unknown op.
+ */
+uint8_t mx_apply_op(Matrix* result, const Matrix* matrix1, const Matrix* matrix2, mx_op op, float alpha, float beta);
+
+/**
+ * @brief Same as mx_apply_op but writes into a newly allocated matrix.
+ *
+ * @return The result or NULL on error.
+ */
+Matrix* mx_apply_op_new(const Matrix* matrix1, const Matrix* matrix2, mx_op op, float alpha, float beta);
 /**
  * Subtracts the elements of the second matrix from the first one, element-wise.
  *
@@ -443,8 +844,14 @@ Matrix* mx_subtract(const Matrix* matrix1, const Matrix* matrix2);
  * If not, it checks if transposing the second matrix will make them compatible.
  * If neither of these conditions are met, the function returns an error.
  *
+ * Transposes are taken as strided views and the operands are never copied, so
+ * the result is the only allocation. With the SCALAR_DOT flag matrix2 is ignored
+ * and matrix1 is scaled by `scalar` (the product with a diagonal matrix).
+ *
  * @param matrix1 Pointer to the first Matrix.
  * @param matrix2 Pointer to the second Matrix.
+ * @param scalar Scale factor used with the SCALAR_DOT flag.
+ * @param flags 1U<<0 for a product (SAFE_DOT), 1U<<1 for scaling (SCALAR_DOT).
  * @return Pointer to the resulting Matrix after multiplication. If the matrices
  *         are not compatible and cannot be made compatible by transposing, 
  *         the function returns NULL.
@@ -454,7 +861,15 @@ Matrix* mx_dot_new(const Matrix* matrix1, const Matrix* matrix2, float scalar, u
 /**
  * @brief Computes the dot product of two matrices.
  * 
- * This function is designed for performance optimization by employing loop unrolling techniques.
+ * Runs a cache-blocked GEMM: the operands are packed into MX_GEMM_MC x MX_GEMM_KC and
+ * MX_GEMM_KC x MX_GEMM_NC panels and multiplied by a register-tiled microkernel.
+ * Products smaller than MX_GEMM_SMALL skip packing and use a plain unrolled loop.
+ * Any row/column strides are accepted, so transposed views can be passed directly.
+ * When either operand is a vector (dst1 has one row or dst2 one column) a GEMV kernel is
+ * used instead: it walks the matrix along its unit stride, as dot products over rows or as
+ * accumulated columns, in blocks of MX_GEMV_BLOCK results.
+ * Once m*n*k reaches MX_THREAD_THRESHOLD the rows of the result are split into
+ * blocks computed on the library thread pool (see mx_parallel_for).
  * 
  * Important Note:
  * The caller MUST ensure that the matrices have compatible dimensions for multiplication 
@@ -470,6 +885,22 @@ Matrix* mx_dot_new(const Matrix* matrix1, const Matrix* matrix2, float scalar, u
  * 
  */
 void mx_fast_dot(const Matrix *src, const Matrix *dst1, const Matrix *dst2);
+
+/**
+ * @brief Forward pass of a fully connected layer: output = activation(input * weights + bias).
+ *
+ * The bias add and the activation run in the GEMM write-back on each tile while it is
+ * still in L1, instead of as separate passes over output after DOT.
+ *
+ * @param output     B x N matrix receiving the activations.
+ * @param input      B x K matrix, one sample per row.
+ * @param weights    K x N matrix.
+ * @param bias       Vector of N values added to every row, or NULL.
+ * @param activation MX_OP_SIGMOID, MX_OP_TANH, MX_OP_RELU, MX_OP_EXP or MX_OP_IDENTITY.
+ * @return 0 on success, -1 on invalid or mismatched matrices or an unsupported activation.
+ */
+uint8_t mx_dense_forward(Matrix* output, const Matrix* input, const Matrix* weights, const Matrix* bias, mx_op activation);
+
 /**
  * Returns a perpendicular vector to the given 2D or 3D matrix-vector.
  *
@@ -500,24 +931,519 @@ Matrix* mx_perpendicular_new(const Matrix* matrix);
 float mx_self_dot_product(Matrix* vector);
 
 Matrix* mx_cross_product_alloc(const Matrix* A, const Matrix* B);
+
+/**
+ * @brief Fixed-size 2x2, 3x3 and 4x4 matrices and 2-4 element vectors.
+ *
+ * Plain structs passed and returned by value, so they live on the stack or in
+ * registers and need no allocation or mx_free. Every operation below is a static
+ * inline function with the size fixed at compile time: loops are fully unrolled
+ * and there are no validity checks, which makes them suitable for transforms done
+ * millions of times per second. Elements are row-major, m[row][col].
+ *
+ * mx_matN_load/mx_matN_store and mx_vecN_load/mx_vecN_store copy between these
+ * types and an existing Matrix of matching shape (any strides; vectors may be a
+ * row or a column) and return 0 on success, -1 on a mismatched or invalid Matrix.
+ */
+typedef struct { precision_type v[2]; } mx_vec2;
+typedef struct { precision_type v[3]; } mx_vec3;
+typedef struct { precision_type v[4]; } mx_vec4;
+typedef struct { precision_type m[2][2]; } mx_mat2;
+typedef struct { precision_type m[3][3]; } mx_mat3;
+typedef struct { precision_type m[4][4]; } mx_mat4;
+
+// fully unrolls the fixed-size loops below; clang also defines __GNUC__, so it goes first
+#if defined(__clang__)
+#define MX_UNROLL _Pragma("clang loop unroll_count(4)")
+#elif defined(__GNUC__)
+#define MX_UNROLL _Pragma("GCC unroll 4")
+#else
+#define MX_UNROLL
+#endif
+
+#define MX_SMALL_OPS(N)                                                                     \
+static inline mx_mat##N mx_mat##N##_identity(void) {                                        \
+    mx_mat##N r = {{{0}}};                                                                  \
+    MX_UNROLL for (int i = 0; i < N; ++i) r.m[i][i] = 1;                                    \
+    return r;                                                                               \
+}                                                                                           \
+                                                                                            \
+static inline mx_mat##N mx_mat##N##_mul(mx_mat##N a, mx_mat##N b) {                         \
+    mx_mat##N r;                                                                            \
+    MX_UNROLL for (int i = 0; i < N; ++i) {                                                 \
+        MX_UNROLL for (int j = 0; j < N; ++j) {                                             \
+            precision_type sum = 0;                                                         \
+            MX_UNROLL for (int k = 0; k < N; ++k) sum += a.m[i][k] * b.m[k][j];             \
+            r.m[i][j] = sum;                                                                \
+        }                                                                                   \
+    }                                                                                       \
+    return r;                                                                               \
+}                                                                                           \
+                                                                                            \
+static inline mx_vec##N mx_mat##N##_mul_vec(mx_mat##N a, mx_vec##N x) {                     \
+    mx_vec##N r;                                                                            \
+    MX_UNROLL for (int i = 0; i < N; ++i) {                                                 \
+        precision_type sum = 0;                                                             \
+        MX_UNROLL for (int k = 0; k < N; ++k) sum += a.m[i][k] * x.v[k];                    \
+        r.v[i] = sum;                                                                       \
+    }                                                                                       \
+    return r;                                                                               \
+}                                                                                           \
+                                                                                            \
+static inline mx_mat##N mx_mat##N##_transpose(mx_mat##N a) {                                \
+    mx_mat##N r;                                                                            \
+    MX_UNROLL for (int i = 0; i < N; ++i) {                                                 \
+        MX_UNROLL for (int j = 0; j < N; ++j) r.m[i][j] = a.m[j][i];                        \
+    }                                                                                       \
+    return r;                                                                               \
+}                                                                                           \
+                                                                                            \
+static inline precision_type mx_vec##N##_dot(mx_vec##N a, mx_vec##N b) {                    \
+    precision_type sum = 0;                                                                 \
+    MX_UNROLL for (int i = 0; i < N; ++i) sum += a.v[i] * b.v[i];                           \
+    return sum;                                                                             \
+}                                                                                           \
+                                                                                            \
+/* a zero vector is returned unchanged */                                                   \
+static inline mx_vec##N mx_vec##N##_normalize(mx_vec##N a) {                                \
+    precision_type length = sqrt(mx_vec##N##_dot(a, a));                                    \
+    if (length == 0) {                                                                      \
+        return a;                                                                           \
+    }                                                                                       \
+    MX_UNROLL for (int i = 0; i < N; ++i) a.v[i] /= length;                                 \
+    return a;                                                                               \
+}                                                                                           \
+                                                                                            \
+static inline uint8_t mx_mat##N##_load(mx_mat##N* out, const Matrix* matrix) {              \
+    if (!VALID_MATRIX(matrix) || matrix->rows != N || matrix->cols != N) {                  \
+        printf("Error: expected a valid %dx%d matrix.\n", N, N);                            \
+        return -1;                                                                          \
+    }                                                                                       \
+    MX_UNROLL for (int i = 0; i < N; ++i) {                                                 \
+        MX_UNROLL for (int j = 0; j < N; ++j) out->m[i][j] = AT(matrix, i, j);              \
+    }                                                                                       \
+    return 0;                                                                               \
+}                                                                                           \
+                                                                                            \
+static inline uint8_t mx_mat##N##_store(const mx_mat##N* in, Matrix* matrix) {              \
+    if (!VALID_MATRIX(matrix) || matrix->rows != N || matrix->cols != N) {                  \
+        printf("Error: expected a valid %dx%d matrix.\n", N, N);                            \
+        return -1;                                                                          \
+    }                                                                                       \
+    MX_UNROLL for (int i = 0; i < N; ++i) {                                                 \
+        MX_UNROLL for (int j = 0; j < N; ++j) AT(matrix, i, j) = in->m[i][j];               \
+    }                                                                                       \
+    return 0;                                                                               \
+}                                                                                           \
+                                                                                            \
+static inline uint8_t mx_vec##N##_load(mx_vec##N* out, const Matrix* matrix) {              \
+    if (!VALID_MATRIX(matrix) || matrix->rows * matrix->cols != N ||                        \
+        (matrix->rows != 1 && matrix->cols != 1)) {                                         \
+        printf("Error: expected a valid vector of %d elements.\n", N);                      \
+        return -1;                                                                          \
+    }                                                                                       \
+    size_t stride = matrix->rows == 1 ? matrix->col_stride : matrix->row_stride;            \
+    const precision_type* data = &AT(matrix, 0, 0);                                         \
+    MX_UNROLL for (int i = 0; i < N; ++i) out->v[i] = data[i * stride];                     \
+    return 0;                                                                               \
+}                                                                                           \
+                                                                                            \
+static inline uint8_t mx_vec##N##_store(const mx_vec##N* in, Matrix* matrix) {              \
+    if (!VALID_MATRIX(matrix) || matrix->rows * matrix->cols != N ||                        \
+        (matrix->rows != 1 && matrix->cols != 1)) {                                         \
+        printf("Error: expected a valid vector of %d elements.\n", N);                      \
+        return -1;                                                                          \
+    }                                                                                       \
+    size_t stride = matrix->rows == 1 ? matrix->col_stride : matrix->row_stride;            \
+    precision_type* data = &AT(matrix, 0, 0);                                               \
+    MX_UNROLL for (int i = 0; i < N; ++i) data[i * stride] = in->v[i];                      \
+    return 0;                                                                               \
+}
+
+MX_SMALL_OPS(2)
+MX_SMALL_OPS(3)
+MX_SMALL_OPS(4)
+
+static inline precision_type mx_mat2_det(mx_mat2 a) {
+    return a.m[0][0] * a.m[1][1] - a.m[0][1] * a.m[1][0];
+}
+
+static inline precision_type mx_mat3_det(mx_mat3 a) {
+    return a.m[0][0] * (a.m[1][1] * a.m[2][2] - a.m[1][2] * a.m[2][1])
+         - a.m[0][1] * (a.m[1][0] * a.m[2][2] - a.m[1][2] * a.m[2][0])
+         + a.m[0][2] * (a.m[1][0] * a.m[2][1] - a.m[1][1] * a.m[2][0]);
+}
+
+// 2x2 minors of the top two rows (s) and the bottom two rows (c), shared by det and inverse
+#define MX_MAT4_MINORS(a)                                                                   \
+    precision_type s0 = a.m[0][0] * a.m[1][1] - a.m[1][0] * a.m[0][1];                      \
+    precision_type s1 = a.m[0][0] * a.m[1][2] - a.m[1][0] * a.m[0][2];                      \
+    precision_type s2 = a.m[0][0] * a.m[1][3] - a.m[1][0] * a.m[0][3];                      \
+    precision_type s3 = a.m[0][1] * a.m[1][2] - a.m[1][1] * a.m[0][2];                      \
+    precision_type s4 = a.m[0][1] * a.m[1][3] - a.m[1][1] * a.m[0][3];                      \
+    precision_type s5 = a.m[0][2] * a.m[1][3] - a.m[1][2] * a.m[0][3];                      \
+    precision_type c0 = a.m[2][0] * a.m[3][1] - a.m[3][0] * a.m[2][1];                      \
+    precision_type c1 = a.m[2][0] * a.m[3][2] - a.m[3][0] * a.m[2][2];                      \
+    precision_type c2 = a.m[2][0] * a.m[3][3] - a.m[3][0] * a.m[2][3];                      \
+    precision_type c3 = a.m[2][1] * a.m[3][2] - a.m[3][1] * a.m[2][2];                      \
+    precision_type c4 = a.m[2][1] * a.m[3][3] - a.m[3][1] * a.m[2][3];                      \
+    precision_type c5 = a.m[2][2] * a.m[3][3] - a.m[3][2] * a.m[2][3];                      \
+    precision_type det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0
+
+static inline precision_type mx_mat4_det(mx_mat4 a) {
+    MX_MAT4_MINORS(a);
+    return det;
+}
+
 /**
- * @brief Extracts a submatrix (or slice) from a given source matrix based on specified start and end indices.
+ * @brief Inverts a fixed-size matrix through its adjugate.
+ * @return 0 on success, -1 if the determinant is zero, in which case out is left unchanged.
+ */
+static inline uint8_t mx_mat2_inverse(mx_mat2 a, mx_mat2* out) {
+    precision_type det = mx_mat2_det(a);
+    if (det == 0) {
+        return -1;
+    }
+    precision_type inv = 1 / det;
+    out->m[0][0] = a.m[1][1] * inv;
+    out->m[0][1] = -a.m[0][1] * inv;
+    out->m[1][0] = -a.m[1][0] * inv;
+    out->m[1][1] = a.m[0][0] * inv;
+    return 0;
+}
+
+static inline uint8_t mx_mat3_inverse(mx_mat3 a, mx_mat3* out) {
+    mx_mat3 adj = {{
+        {a.m[1][1] * a.m[2][2] - a.m[1][2] * a.m[2][1], a.m[0][2] * a.m[2][1] - a.m[0][1] * a.m[2][2],
+         a.m[0][1] * a.m[1][2] - a.m[0][2] * a.m[1][1]},
+        {a.m[1][2] * a.m[2][0] - a.m[1][0] * a.m[2][2], a.m[0][0] * a.m[2][2] - a.m[0][2] * a.m[2][0],
+         a.m[0][2] * a.m[1][0] - a.m[0][0] * a.m[1][2]},
+        {a.m[1][0] * a.m[2][1] - a.m[1][1] * a.m[2][0], a.m[0][1] * a.m[2][0] - a.m[0][0] * a.m[2][1],
+         a.m[0][0] * a.m[1][1] - a.m[0][1] * a.m[1][0]},
+    }};
+    precision_type det = a.m[0][0] * adj.m[0][0] + a.m[0][1] * adj.m[1][0] + a.m[0][2] * adj.m[2][0];
+    if (det == 0) {
+        return -1;
+    }
+    precision_type inv = 1 / det;
+    MX_UNROLL for (int i = 0; i < 3; ++i) {
+        MX_UNROLL for (int j = 0; j < 3; ++j) out->m[i][j] = adj.m[i][j] * inv;
+    }
+    return 0;
+}
+
+static inline uint8_t mx_mat4_inverse(mx_mat4 a, mx_mat4* out) {
+    MX_MAT4_MINORS(a);
+    if (det == 0) {
+        return -1;
+    }
+    precision_type inv = 1 / det;
+    mx_mat4 r = {{
+        {( a.m[1][1] * c5 - a.m[1][2] * c4 + a.m[1][3] * c3) * inv,
+         (-a.m[0][1] * c5 + a.m[0][2] * c4 - a.m[0][3] * c3) * inv,
+         ( a.m[3][1] * s5 - a.m[3][2] * s4 + a.m[3][3] * s3) * inv,
+         (-a.m[2][1] * s5 + a.m[2][2] * s4 - a.m[2][3] * s3) * inv},
+        {(-a.m[1][0] * c5 + a.m[1][2] * c2 - a.m[1][3] * c1) * inv,
+         ( a.m[0][0] * c5 - a.m[0][2] * c2 + a.m[0][3] * c1) * inv,
+         (-a.m[3][0] * s5 + a.m[3][2] * s2 - a.m[3][3] * s1) * inv,
+         ( a.m[2][0] * s5 - a.m[2][2] * s2 + a.m[2][3] * s1) * inv},
+        {( a.m[1][0] * c4 - a.m[1][1] * c2 + a.m[1][3] * c0) * inv,
+         (-a.m[0][0] * c4 + a.m[0][1] * c2 - a.m[0][3] * c0) * inv,
+         ( a.m[3][0] * s4 - a.m[3][1] * s2 + a.m[3][3] * s0) * inv,
+         (-a.m[2][0] * s4 + a.m[2][1] * s2 - a.m[2][3] * s0) * inv},
+        {(-a.m[1][0] * c3 + a.m[1][1] * c1 - a.m[1][2] * c0) * inv,
+         ( a.m[0][0] * c3 - a.m[0][1] * c1 + a.m[0][2] * c0) * inv,
+         (-a.m[3][0] * s3 + a.m[3][1] * s1 - a.m[3][2] * s0) * inv,
+         ( a.m[2][0] * s3 - a.m[2][1] * s1 + a.m[2][2] * s0) * inv},
+    }};
+    *out = r;
+    return 0;
+}
+
+static inline mx_vec3 mx_vec3_cross(mx_vec3 a, mx_vec3 b) {
+    mx_vec3 r = {{
+        a.v[1] * b.v[2] - a.v[2] * b.v[1],
+        a.v[2] * b.v[0] - a.v[0] * b.v[2],
+        a.v[0] * b.v[1] - a.v[1] * b.v[0],
+    }};
+    return r;
+}
+
+/**
+ * @brief Creates a view of a submatrix (or slice) of a given source matrix.
  * 
- * This function creates a new matrix using the given indices and copies the appropriate values from 
- * the source matrix to this new matrix. If invalid indices are provided (for example, if start_row is 
- * greater than end_row or if the indices go out of bounds of the source matrix), the function will return NULL.
+ * The slice shares the container of the source matrix: it only records the offset of its
+ * first element and keeps the source strides, so no element is copied and writes through
+ * the slice are visible in the source. The container stays alive until both are freed.
+ * If invalid indices are provided (for example, if start_row is greater than end_row or
+ * if the indices go out of bounds of the source matrix), the function will return NULL.
  *
  * @param src Pointer to the source matrix.
  * @param start_row Starting row index for the slice.
  * @param end_row Ending row index for the slice.
  * @param start_col Starting column index for the slice.
  * @param end_col Ending column index for the slice.
- * @return Pointer to the new Matrix containing the slice. Returns NULL if indices are invalid.
+ * @return Pointer to the new Matrix viewing the slice. Returns NULL if indices are invalid.
  */
 Matrix* mx_slice(const Matrix* src, size_t start_row, size_t end_row, size_t start_col, size_t end_col);
 
+/**
+ * @brief Copies a submatrix of a given source matrix into a new dense matrix.
+ *
+ * Same indices as mx_slice, but the result owns its data.
+ *
+ * @return Pointer to the new Matrix containing the slice. Returns NULL if indices are invalid.
+ */
+Matrix* mx_slice_copy(const Matrix* src, size_t start_row, size_t end_row, size_t start_col, size_t end_col);
+
+/**
+ * @brief Computes the inverse of a square matrix.
+ *
+ * Solves input * output = I against the pivoted LU factors of a copy of input
+ * (see mx_lu); input is not modified. To solve a linear system, mx_solve or
+ * mx_lu_solve are cheaper and more accurate than multiplying by the inverse.
+ *
+ * @param input  Square matrix to invert.
+ * @param output Matrix of the same size that receives the inverse.
+ * @return 1 on success, -1 on mismatched sizes or a singular matrix.
+ */
 uint8_t mx_inverse(Matrix *input, Matrix *output);
+
+/**
+ * @brief Factors a square matrix in place as P * a = L * U, with partial pivoting.
+ *
+ * On return the strictly lower part of a holds L (its unit diagonal is implied) and
+ * the upper part U. Row i was swapped with row pivots[i], in order from i = 0.
+ * Columns are factored in panels of MX_LU_BLOCK; the update of the trailing matrix
+ * after each panel is a blocked matrix product run like DOT, so large factorizations
+ * use the GEMM kernels and the thread pool.
+ *
+ * @param a      Square matrix, overwritten by its factors.
+ * @param pivots Array of a->rows entries that receives the row swaps.
+ * @return 0 on success, -1 on an invalid or non-square matrix, or if a is singular
+ *         (a zero pivot); a singular factorization is still completed.
+ */
+uint8_t mx_lu(Matrix* a, size_t* pivots);
+
+/**
+ * @brief Solves A * X = B in place from the factors computed by mx_lu.
+ *
+ * Every column of b is a right-hand side, so one factorization serves any number
+ * of them, in one call or many.
+ *
+ * @param lu     Factors written by mx_lu.
+ * @param pivots Row swaps written by mx_lu.
+ * @param b      n x k right-hand sides, overwritten by the solutions.
+ * @return 0 on success, -1 on mismatched sizes or a singular factorization.
+ */
+uint8_t mx_lu_solve(const Matrix* lu, const size_t* pivots, Matrix* b);
+
+/**
+ * @brief Solves A * X = B for a square A, without modifying either argument.
+ *
+ * Factors a copy of a with mx_lu and calls mx_lu_solve on a copy of b.
+ *
+ * @return A new matrix holding X, or NULL on invalid or mismatched matrices or a singular A.
+ */
+Matrix* mx_solve(const Matrix* a, const Matrix* b);
+
+/**
+ * @brief Factors a symmetric positive-definite matrix in place as a = L * L^T.
+ *
+ * Only the lower triangle of a is read. On return a holds L, with zeros above the
+ * diagonal. Columns are factored in panels of MX_LU_BLOCK: the rows below each
+ * diagonal block are solved on the thread pool and the trailing lower triangle is
+ * updated with blocked matrix products, one block column at a time, which is
+ * about half the flops of mx_lu.
+ *
+ * @param a Square matrix, overwritten by L.
+ * @return 0 on success, -1 on an invalid or non-square matrix, or if a is not
+ *         positive definite (a is then partially overwritten).
+ */
+uint8_t mx_cholesky(Matrix* a);
+
+/**
+ * @brief Solves A * X = B in place from the factor L computed by mx_cholesky.
+ *
+ * Runs forward substitution with L and back substitution with L^T; every column
+ * of b is a right-hand side.
+ *
+ * @param l Factor written by mx_cholesky.
+ * @param b n x k right-hand sides, overwritten by the solutions.
+ * @return 0 on success, -1 on mismatched sizes or a zero on the diagonal of l.
+ */
+uint8_t mx_cholesky_solve(const Matrix* l, Matrix* b);
+
+/**
+ * @brief Solves A * X = B for a symmetric positive-definite A, without modifying either argument.
+ *
+ * @return A new matrix holding X, or NULL on invalid or mismatched matrices or an A
+ *         that is not positive definite.
+ */
+Matrix* mx_spd_solve(const Matrix* a, const Matrix* b);
+
+/**
+ * @brief Which triangle of a triangular operand is used, and how (see mx_trsm).
+ *
+ * Flags are combined with |; MX_LOWER and left-side application are the defaults.
+ */
+typedef enum {
+    MX_LOWER = 0,               /**< a is lower triangular */
+    MX_UPPER = 1 << 0,          /**< a is upper triangular */
+    MX_UNIT_DIAGONAL = 1 << 1,  /**< the diagonal of a is taken as ones and never read */
+    MX_RIGHT = 1 << 2           /**< a is applied from the right of b */
+} mx_triangle;
+
+/**
+ * @brief Solves a triangular system in place: b = a^-1 * b, or b = b * a^-1 with MX_RIGHT.
+ *
+ * Only the triangle of a named by flags is read, so a can be the packed output of a
+ * factorization: the L and U of mx_lu, the L of mx_cholesky or the R of mx_qr. For
+ * transposed factors, pass a TRANSPOSE_VIEW and the opposite triangle. The triangle
+ * is split in halves down to MX_TRSM_LEAF rows; everything above the leaves is matrix
+ * products on the GEMM kernels and the thread pool.
+ *
+ * @param a     n x n triangular matrix.
+ * @param b     n x k matrix (k x n with MX_RIGHT), overwritten by the solution.
+ * @param flags Combination of mx_triangle values.
+ * @return 0 on success, -1 on mismatched sizes or a zero on the diagonal of a.
+ */
+uint8_t mx_trsm(const Matrix* a, Matrix* b, int flags);
+
+/**
+ * @brief Multiplies by a triangular matrix in place: b = a * b, or b = b * a with MX_RIGHT.
+ *
+ * Reads a and splits the work like mx_trsm.
+ *
+ * @param a     n x n triangular matrix.
+ * @param b     n x k matrix (k x n with MX_RIGHT), overwritten by the product.
+ * @param flags Combination of mx_triangle values.
+ * @return 0 on success, -1 on mismatched sizes.
+ */
+uint8_t mx_trmm(const Matrix* a, Matrix* b, int flags);
+
+/**
+ * @brief Householder QR factorization in place: a = Q * R, for a with rows >= cols.
+ *
+ * On return R is on and above the diagonal of a. Q is kept in factored form, as
+ * the product of the reflectors H_j = I - tau[j] * v_j * v_j^T, where v_j has an
+ * implied 1 at row j and its remaining entries are stored below the diagonal of
+ * column j.
+ *
+ * Columns are processed in panels of MX_QR_BLOCK. Each panel is factored in a
+ * column-major copy; its reflectors are then applied to the rest of the matrix as
+ * I - V*T*V^T (compact WY), that is, as matrix products on the GEMM kernels.
+ *
+ * @param a   Matrix with at least as many rows as columns, overwritten by the factors.
+ * @param tau Array of a->cols entries that receives the reflector scales.
+ * @return 0 on success, -1 on an invalid matrix, a wide matrix, or a failed allocation.
+ */
+uint8_t mx_qr(Matrix* a, precision_type* tau);
+
+/**
+ * @brief Computes b = Q^T * b in place from the factors written by mx_qr.
+ *
+ * @param qr  Factors written by mx_qr.
+ * @param tau Reflector scales written by mx_qr.
+ * @param b   Matrix with as many rows as qr, overwritten by Q^T * b.
+ * @return 0 on success, -1 on mismatched sizes or a failed allocation.
+ */
+uint8_t mx_qr_apply_qt(const Matrix* qr, const precision_type* tau, Matrix* b);
+
+/**
+ * @brief Solves the least-squares problem min ||A * X - B|| for a tall, full-rank A.
+ *
+ * Factors a copy of [a | b] with Householder QR (see mx_qr), so Q^T * b falls out
+ * of the factorization, and the normal equations A^T * A, which square the condition
+ * number, are never formed. Every column of b is a separate right-hand side.
+ *
+ * @param a m x n matrix with m >= n.
+ * @param b m x k right-hand sides.
+ * @return A new n x k matrix holding X, or NULL on invalid or mismatched matrices
+ *         or a numerically rank-deficient A: a diagonal entry of R at or below
+ *         max|R_jj| * max(m, n) * epsilon of precision_type.
+ */
+Matrix* mx_lstsq(const Matrix* a, const Matrix* b);
+
+/**
+ * @brief Computes the eigenvalues and eigenvectors of a symmetric matrix.
+ *
+ * Reduces a copy of a to tridiagonal form with Householder reflectors, then finds
+ * the eigenvalues of the tridiagonal matrix with implicit QL sweeps. Only the lower
+ * triangle of a is read.
+ *
+ * @param a            Symmetric n x n matrix, left untouched.
+ * @param eigenvalues  Array of n entries that receives the eigenvalues in ascending order.
+ * @param eigenvectors n x n matrix whose columns receive the matching unit eigenvectors,
+ *                     or NULL to compute the eigenvalues only.
+ * @return 0 on success, -1 on an invalid or non-square matrix, a failed allocation,
+ *         or an iteration that did not converge.
+ */
+uint8_t mx_eigh(const Matrix* a, precision_type* eigenvalues, Matrix* eigenvectors);
+
+/**
+ * @brief Computes the k largest singular values and vectors of a with a randomized SVD.
+ *
+ * A random sketch A * Omega of k + MX_SVD_OVERSAMPLING columns is refined by
+ * MX_SVD_POWER_ITERATIONS power iterations and orthonormalized into Q; the small
+ * SVD of Q^T * A is then taken through the eigenvalues of its Gram matrix (see mx_eigh).
+ * Apart from that small problem all the work is matrix products on the threaded GEMM,
+ * and a is read 2 * MX_SVD_POWER_ITERATIONS + 2 times.
+ *
+ * Singular values far below the largest (under about sqrt(FLT_EPSILON) of it) lose
+ * relative accuracy, which is of no concern for picking the top components.
+ * The sketch is drawn with rand().
+ *
+ * @param a m x n matrix.
+ * @param k Number of components, 0 < k <= min(m, n).
+ * @param u m x k matrix that receives the left singular vectors, or NULL.
+ * @param s Array of k entries that receives the singular values in descending order.
+ * @param v n x k matrix that receives the right singular vectors, or NULL.
+ * @return 0 on success, -1 on invalid arguments or a failed allocation.
+ */
+uint8_t mx_svd_truncated(const Matrix* a, size_t k, Matrix* u, precision_type* s, Matrix* v);
+/**
+ * @brief Loads a comma separated file of numbers into a new matrix.
+ *
+ * The file is memory-mapped and parsed in a single pass; there is no limit on
+ * the length of a row. Files of MX_CSV_CHUNK bytes or more are split at line
+ * boundaries and parsed on the thread pool. Blank lines are skipped, CRLF line
+ * endings and spaces around fields are accepted.
+ *
+ * @param name Path to the file.
+ * @return Pointer to a new matrix with one row per line. Returns NULL if the file
+ *         cannot be read, is empty, or a row has a bad field or the wrong number of fields.
+ */
 Matrix* open_dataset(const char* name);
+
+/**
+ * @brief Writes a matrix to a binary .mxb file.
+ *
+ * The file is a 64 byte header (magic "MXB1", byte order mark, element size,
+ * data alignment, rows, cols, row and col strides, data offset and element
+ * count) followed by the raw elements at an offset aligned to MX_ALIGN_MXB.
+ * Matrices whose strides address exactly rows x cols elements, such as dense
+ * matrices and transposed views, are written with their strides unchanged;
+ * any other layout is packed row-major first.
+ *
+ * @param matrix Pointer to the matrix to save.
+ * @param name Path of the file to create or overwrite.
+ * @return 0 on success, -1 on error.
+ */
+uint8_t mx_save(const Matrix* matrix, const char* name);
+
+/**
+ * @brief Loads a matrix saved by mx_save without copying its elements.
+ *
+ * The file is memory-mapped copy-on-write and the mapping becomes the matrix
+ * container, so loading costs the same for any file size and writes to the
+ * matrix never reach the file. The mapping is released by mx_free.
+ *
+ * @param name Path to the .mxb file.
+ * @return Pointer to the loaded matrix, or NULL if the file cannot be mapped,
+ *         is truncated, or was saved with a different precision or byte order.
+ */
+Matrix* mx_load(const char* name);
 void mx_nn_free(NN* nn);
 uint8_t mx_print(const Matrix* matrix, const char* name, size_t padding);
 void mx_nn_print(const NN* nn, const char* name);
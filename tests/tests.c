@@ -1,5 +1,6 @@
 #include "unity.h"
 #include "../mx.h" 
+#include <pthread.h>
 #define MX_IMPLEMENTATION
 
 void setUp(void) {
@@ -42,7 +43,7 @@ void test_mx_arrange_alloc_correctness(void) {
 void test_basic_free(void)
 {
     Matrix *mat = malloc(sizeof(Matrix));
-    mat->container = malloc(sizeof(__matrix_container));
+    mat->container = calloc(1, sizeof(__matrix_container));
     mat->container->data = malloc(10 * sizeof(float));
     mat->container->ref_count = 1;
 
@@ -65,15 +66,15 @@ void test_ref_count_free(void)
     TEST_ASSERT_NOT_NULL(ct->data);
     TEST_ASSERT_EQUAL_INT(1, ct->ref_count);
 
-    // Cleanup
-    free(ct->data);
-    free(ct);
+    // Cleanup: MATRIX allocates the header together with the container, so the
+    // header stays valid while references remain; drop the last one through it
+    mx_free(mat);
 }
 
 void test_data_check(void)
 {
     Matrix *mat = malloc(sizeof(Matrix));
-    mat->container = malloc(sizeof(__matrix_container));
+    mat->container = calloc(1, sizeof(__matrix_container));
     mat->container->data = malloc(10 * sizeof(float));
     mat->container->ref_count = 1;
 
@@ -86,7 +87,7 @@ void test_data_check(void)
 void test_container_check(void)
 {
     Matrix *mat = malloc(sizeof(Matrix));
-    mat->container = malloc(sizeof(__matrix_container));
+    mat->container = calloc(1, sizeof(__matrix_container));
     mat->container->data = malloc(10 * sizeof(float));
     mat->container->ref_count = 1;
 
@@ -651,6 +652,516 @@ void test_dot_matrix_and_its_transpose(void) {
     mx_free(result);
 }
 
+// deterministic fill that leaves the rand() sequence of the other tests untouched
+static void fill_pattern(Matrix* m, unsigned seed) {
+    for (size_t i = 0; i < m->rows; i++) {
+        for (size_t j = 0; j < m->cols; j++) {
+            seed = seed * 1103515245u + 12345u;
+            AT(m, i, j) = (float)((seed >> 8) & 0xFFFF) / 32768.0f - 1.0f;
+        }
+    }
+}
+
+static float reference_dot_at(const Matrix* a, const Matrix* b, size_t i, size_t j) {
+    double sum = 0;
+    for (size_t k = 0; k < a->cols; k++) {
+        sum += (double)AT(a, i, k) * AT(b, k, j);
+    }
+    return (float)sum;
+}
+
+void test_dot_new_auto_transpose_and_scalar(void) {
+    Matrix* a = MATRIX(5, 3);
+    Matrix* b = MATRIX(4, 3);
+    fill_pattern(a, 30);
+    fill_pattern(b, 31);
+    mx_buffer_pool_enable(1);
+    mx_buffer_pool_drain();
+
+    // a * b^T through a view: the result is the only allocation
+    mx_buffer_pool_stats before = mx_buffer_pool_get_stats();
+    Matrix* result = SAFE_DOT(a, b);
+    mx_buffer_pool_stats after = mx_buffer_pool_get_stats();
+    TEST_ASSERT_EQUAL_UINT(1, (after.hits + after.misses) - (before.hits + before.misses));
+    TEST_ASSERT_EQUAL_UINT(5, result->rows);
+    TEST_ASSERT_EQUAL_UINT(4, result->cols);
+    Matrix* b_t = TRANSPOSE_VIEW(b);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, reference_dot_at(a, b_t, 4, 2), AT(result, 4, 2));
+
+    Matrix* scaled = SCALAR_DOT(a, -3);
+    TEST_ASSERT_EQUAL_UINT(5, scaled->rows);
+    TEST_ASSERT_EQUAL_UINT(3, scaled->cols);
+    for (size_t i = 0; i < 5; i++) {
+        for (size_t j = 0; j < 3; j++) {
+            TEST_ASSERT_EQUAL_FLOAT(-3 * AT(a, i, j), AT(scaled, i, j));
+        }
+    }
+    TEST_ASSERT_NULL(mx_dot_new(a, b, 0, 0));
+
+    mx_buffer_pool_enable(0);
+    mx_free(a);
+    mx_free(b);
+    mx_free(b_t);
+    mx_free(result);
+    mx_free(scaled);
+}
+
+void test_fast_dot_blocked_matches_reference(void) {
+    // odd sizes larger than MX_GEMM_MC/MX_GEMM_KC to hit every edge case of the blocking
+    Matrix* a = MATRIX(131, 301);
+    Matrix* b = MATRIX(301, 67);
+    fill_pattern(a, 1);
+    fill_pattern(b, 2);
+    Matrix* c = MATRIX(131, 67);
+
+    DOT(c, a, b);
+
+    for (size_t i = 0; i < c->rows; i++) {
+        for (size_t j = 0; j < c->cols; j++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-3, reference_dot_at(a, b, i, j), AT(c, i, j));
+        }
+    }
+
+    mx_free(a);
+    mx_free(b);
+    mx_free(c);
+}
+
+void test_fast_dot_blocked_transposed_operands(void) {
+    Matrix* a = MATRIX(90, 120);
+    Matrix* b = MATRIX(70, 90);
+    fill_pattern(a, 3);
+    fill_pattern(b, 4);
+    Matrix* at = TRANSPOSE_VIEW(a); // 120 x 90
+    Matrix* bt = TRANSPOSE_VIEW(b); // 90 x 70
+    Matrix* c = MATRIX(120, 70);
+
+    DOT(c, at, bt);
+
+    for (size_t i = 0; i < c->rows; i++) {
+        for (size_t j = 0; j < c->cols; j++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-3, reference_dot_at(at, bt, i, j), AT(c, i, j));
+        }
+    }
+
+    mx_free(at);
+    mx_free(bt);
+    mx_free(a);
+    mx_free(b);
+    mx_free(c);
+}
+
+// same values under a transposed layout: a dense cols x rows buffer seen through TRANSPOSE_VIEW
+static Matrix* transposed_storage(const Matrix* m, Matrix** storage) {
+    *storage = MATRIX(m->cols, m->rows);
+    for (size_t i = 0; i < m->rows; i++) {
+        for (size_t j = 0; j < m->cols; j++) {
+            AT(*storage, j, i) = AT(m, i, j);
+        }
+    }
+    return TRANSPOSE_VIEW(*storage);
+}
+
+void test_fast_dot_layouts_agree(void) {
+    // packing reads each layout along its unit stride; the packed panels and so the results must not change
+    Matrix* a = MATRIX(75, 290);
+    Matrix* b = MATRIX(290, 41);
+    fill_pattern(a, 32);
+    fill_pattern(b, 33);
+    Matrix *a_store, *b_store;
+    Matrix* a_t = transposed_storage(a, &a_store);
+    Matrix* b_t = transposed_storage(b, &b_store);
+
+    // every other column of a wider matrix: neither stride is 1
+    Matrix* wide = MATRIX(75, 580);
+    for (size_t i = 0; i < 75; i++) {
+        for (size_t j = 0; j < 290; j++) {
+            AT(wide, i, 2 * j) = AT(a, i, j);
+        }
+    }
+    Matrix* a_gather = MATRIX_VIEW(wide);
+    a_gather->rows = 75;
+    a_gather->cols = 290;
+    a_gather->col_stride = 2;
+
+    const Matrix* lhs[] = {a, a, a_t, a_t, a_gather};
+    const Matrix* rhs[] = {b, b_t, b, b_t, b};
+    Matrix* expected = MATRIX(75, 41);
+    Matrix* c = MATRIX(75, 41);
+    DOT(expected, a, b);
+    for (size_t v = 1; v < 5; v++) {
+        DOT(c, lhs[v], rhs[v]);
+        TEST_ASSERT_EQUAL_FLOAT_ARRAY(expected->container->data, c->container->data, 75 * 41);
+    }
+
+    mx_free(a);
+    mx_free(b);
+    mx_free(a_t);
+    mx_free(b_t);
+    mx_free(a_store);
+    mx_free(b_store);
+    mx_free(a_gather);
+    mx_free(wide);
+    mx_free(expected);
+    mx_free(c);
+}
+
+void test_dot_vector_operands(void) {
+    // 1100 rows span two MX_GEMV_BLOCK blocks and, with k = 301, run on the thread pool
+    size_t m = 1100, k = 301;
+    Matrix* a = MATRIX(m, k);
+    fill_pattern(a, 34);
+    Matrix* a_store;
+    Matrix* a_t = transposed_storage(a, &a_store);
+
+    // x once contiguous and once as the middle column of a k x 3 matrix
+    Matrix* x = MATRIX(k, 1);
+    Matrix* x_cols = MATRIX(k, 3);
+    fill_pattern(x, 35);
+    for (size_t p = 0; p < k; p++) {
+        AT(x_cols, p, 1) = AT(x, p, 0);
+    }
+    Matrix* x_strided = COL_SLICE(x_cols, 1, 1);
+    Matrix* x_row = TRANSPOSE_VIEW(x);
+    Matrix* a_rows = TRANSPOSE_VIEW(a);
+    Matrix* a_t_rows = TRANSPOSE_VIEW(a_t);
+
+    Matrix* y = MATRIX(m, 1);
+    Matrix* y_row = MATRIX(1, m);
+    const Matrix* mats[] = {a, a_t};
+    const Matrix* mats_rows[] = {a_rows, a_t_rows};
+    const Matrix* vecs[] = {x, x_strided};
+    for (size_t l = 0; l < 2; l++) {
+        for (size_t v = 0; v < 2; v++) {
+            // GEMV: y = A x
+            DOT(y, mats[l], vecs[v]);
+            for (size_t i = 0; i < m; i++) {
+                TEST_ASSERT_FLOAT_WITHIN(1e-3, reference_dot_at(a, x, i, 0), AT(y, i, 0));
+            }
+        }
+        // GEVM: y^T = x^T A^T
+        DOT(y_row, x_row, mats_rows[l]);
+        for (size_t i = 0; i < m; i++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-3, reference_dot_at(a, x, i, 0), AT(y_row, 0, i));
+        }
+    }
+
+    mx_free(a);
+    mx_free(a_t);
+    mx_free(a_store);
+    mx_free(a_rows);
+    mx_free(a_t_rows);
+    mx_free(x);
+    mx_free(x_cols);
+    mx_free(x_strided);
+    mx_free(x_row);
+    mx_free(y);
+    mx_free(y_row);
+}
+
+void test_safe_dot_threaded_row_blocks(void) {
+    // above MX_THREAD_THRESHOLD with a row count that does not split evenly
+    Matrix* a = MATRIX(257, 129);
+    Matrix* b = MATRIX(129, 95);
+    fill_pattern(a, 5);
+    fill_pattern(b, 6);
+
+    Matrix* c = SAFE_DOT(a, b);
+
+    TEST_ASSERT_NOT_NULL(c);
+    TEST_ASSERT_EQUAL_UINT(257, c->rows);
+    TEST_ASSERT_EQUAL_UINT(95, c->cols);
+    for (size_t i = 0; i < c->rows; i++) {
+        for (size_t j = 0; j < c->cols; j++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-3, reference_dot_at(a, b, i, j), AT(c, i, j));
+        }
+    }
+
+    mx_free(a);
+    mx_free(b);
+    mx_free(c);
+}
+
+static size_t parallel_calls[64];
+
+static void count_indices(size_t start, size_t end, void* arg) {
+    size_t* visits = arg;
+    for (size_t i = start; i < end; i++) {
+        visits[i]++;
+    }
+    parallel_calls[start / 16]++;
+}
+
+void test_parallel_for_visits_each_index_once(void) {
+    size_t visits[1000] = {0};
+    memset(parallel_calls, 0, sizeof(parallel_calls));
+    mx_set_num_threads(4);
+
+    mx_parallel_for(1000, 16, count_indices, visits);
+
+    for (size_t i = 0; i < 1000; i++) {
+        TEST_ASSERT_EQUAL_UINT(1, visits[i]);
+    }
+    for (size_t c = 0; c < 63; c++) {
+        TEST_ASSERT_EQUAL_UINT(1, parallel_calls[c]);
+    }
+
+    mx_set_num_threads(0);
+}
+
+void test_thread_pool_kernels_match_serial(void) {
+    Matrix* a = MATRIX(300, 257);
+    Matrix* b = MATRIX(257, 300);
+    fill_pattern(a, 7);
+    fill_pattern(b, 8);
+    Matrix* serial = MATRIX(300, 300);
+    Matrix* threaded = MATRIX(300, 300);
+
+    mx_set_num_threads(1);
+    DOT(serial, a, b);
+    ADD(serial, serial);
+    mx_apply_sigmoid(serial);
+    float serial_length = mx_length(serial);
+
+    mx_set_num_threads(4);
+    DOT(threaded, a, b);
+    ADD(threaded, threaded);
+    mx_apply_sigmoid(threaded);
+    float threaded_length = mx_length(threaded);
+    mx_thread_pool_shutdown();
+
+    TEST_ASSERT_TRUE(mx_equal(serial, threaded));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, serial_length, threaded_length);
+
+    mx_set_num_threads(0);
+    mx_free(a);
+    mx_free(b);
+    mx_free(serial);
+    mx_free(threaded);
+}
+
+void test_simd_levels_match_scalar(void) {
+    // odd sizes so every kernel runs its vector body and its tail
+    Matrix* a = MATRIX(67, 45);
+    Matrix* b = MATRIX(45, 83);
+    fill_pattern(a, 11);
+    fill_pattern(b, 12);
+    Matrix* scalar = MATRIX(67, 83);
+    Matrix* vector = MATRIX(67, 83);
+    mx_simd_level best = mx_get_simd_level();
+
+    TEST_ASSERT_EQUAL(MX_SIMD_SCALAR, mx_set_simd_level(MX_SIMD_SCALAR));
+    DOT(scalar, a, b);
+    Matrix* scalar_scaled = mx_scale(scalar, -3.0f);
+    SUBTRACT(scalar, scalar_scaled);
+    float scalar_length = mx_length(scalar);
+    mx_apply_sigmoid(scalar);
+
+    for (mx_simd_level level = MX_SIMD_SSE; level <= best; level++) {
+        TEST_ASSERT_EQUAL(level, mx_set_simd_level(level));
+        DOT(vector, a, b);
+        Matrix* vector_scaled = mx_scale(vector, -3.0f);
+        SUBTRACT(vector, vector_scaled);
+        TEST_ASSERT_FLOAT_WITHIN(1e-2, scalar_length, mx_length(vector));
+        mx_apply_sigmoid(vector);
+        for (size_t i = 0; i < vector->rows; i++) {
+            for (size_t j = 0; j < vector->cols; j++) {
+                TEST_ASSERT_FLOAT_WITHIN(1e-5, AT(scalar, i, j), AT(vector, i, j));
+            }
+        }
+        mx_free(vector_scaled);
+    }
+
+    TEST_ASSERT_EQUAL(best, mx_set_simd_level(MX_SIMD_AVX512));
+    mx_free(a);
+    mx_free(b);
+    mx_free(scalar);
+    mx_free(scalar_scaled);
+    mx_free(vector);
+}
+
+void test_simd_sigmoid_extreme_inputs(void) {
+    float data[] = {-1000.0f, -88.0f, -20.0f, -1.0f, 0.0f, 1.0f, 20.0f, 88.0f, 1000.0f};
+    Matrix* m = MATRIX_FROM(data, 1, 9);
+
+    mx_apply_sigmoid(m);
+
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0f, AT(m, 0, 0));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.2689414f, AT(m, 0, 3));
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, AT(m, 0, 4));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.7310586f, AT(m, 0, 5));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0f, AT(m, 0, 8));
+    for (size_t j = 0; j < 9; j++) {
+        TEST_ASSERT_FALSE(isnan(AT(m, 0, j)));
+    }
+    mx_free(m);
+}
+
+static float reference_op(mx_op op, float x, float y) {
+    switch (op) {
+    case MX_OP_ADD: return x + y;
+    case MX_OP_SUB: return x - y;
+    case MX_OP_MUL: return x * y;
+    case MX_OP_DIV: return x / y;
+    case MX_OP_AXPY: return 0.5f * x + y;
+    case MX_OP_SCALE: return 0.5f * x;
+    case MX_OP_CLAMP: return x < -0.25f ? -0.25f : (x > 0.25f ? 0.25f : x);
+    case MX_OP_SIGMOID: return 1.0f / (1.0f + expf(-x));
+    case MX_OP_TANH: return tanhf(x);
+    case MX_OP_RELU: return x > 0 ? x : 0;
+    case MX_OP_EXP: return expf(x);
+    case MX_OP_LOG: return logf(fabsf(x));
+    case MX_OP_IDENTITY: return x;
+    default: return NAN;
+    }
+}
+
+void test_apply_op_matches_reference(void) {
+    Matrix* a = MATRIX(13, 37);
+    Matrix* b = MATRIX(13, 37);
+    fill_pattern(a, 21);
+    fill_pattern(b, 22);
+    Matrix* positive = MATRIX(13, 37);
+    Matrix* result = MATRIX(13, 37);
+    mx_simd_level best = mx_get_simd_level();
+
+    for (size_t i = 0; i < a->rows; i++) {
+        for (size_t j = 0; j < a->cols; j++) {
+            AT(a, i, j) *= 4.0f;
+            AT(b, i, j) += AT(b, i, j) < 0 ? -0.5f : 0.5f; // keep divisors away from 0
+            AT(positive, i, j) = fabsf(AT(a, i, j));
+        }
+    }
+
+    for (mx_simd_level level = MX_SIMD_SCALAR; level <= best; level++) {
+        mx_set_simd_level(level);
+        for (mx_op op = MX_OP_ADD; op < MX_OP_COUNT; op++) {
+            const Matrix* input = op == MX_OP_LOG ? positive : a;
+            TEST_ASSERT_EQUAL(0, mx_apply_op(result, input, b, op, op == MX_OP_CLAMP ? -0.25f : 0.5f, 0.25f));
+            for (size_t i = 0; i < a->rows; i++) {
+                for (size_t j = 0; j < a->cols; j++) {
+                    float expected = reference_op(op, AT(a, i, j), AT(b, i, j));
+                    TEST_ASSERT_FLOAT_WITHIN(1e-5f * (1.0f + fabsf(expected)), expected, AT(result, i, j));
+                }
+            }
+        }
+    }
+
+    mx_set_simd_level(best);
+    mx_free(a);
+    mx_free(b);
+    mx_free(positive);
+    mx_free(result);
+}
+
+void test_apply_op_special_values(void) {
+    float data[] = {0.0f, -1.0f, INFINITY, 1e-40f, 1.0f, 2.0f, 1e-6f, -1e-6f,
+                    -INFINITY, 100.0f, -100.0f, 0.5f, 3.0f, 4.0f, 5.0f, 6.0f};
+    Matrix* m = MATRIX_FROM(data, 1, 16);
+    Matrix* log = mx_apply_op_new(m, NULL, MX_OP_LOG, 0, 0);
+    Matrix* tanh = mx_apply_op_new(m, NULL, MX_OP_TANH, 0, 0);
+    Matrix* exp = mx_apply_op_new(m, NULL, MX_OP_EXP, 0, 0);
+
+    TEST_ASSERT_TRUE(isinf(AT(log, 0, 0)) && AT(log, 0, 0) < 0);
+    TEST_ASSERT_TRUE(isnan(AT(log, 0, 1)));
+    TEST_ASSERT_TRUE(isinf(AT(log, 0, 2)) && AT(log, 0, 2) > 0);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, logf(1e-40f), AT(log, 0, 3));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, AT(log, 0, 4));
+    TEST_ASSERT_FLOAT_WITHIN(1e-12, 1e-6f, AT(tanh, 0, 6));
+    TEST_ASSERT_FLOAT_WITHIN(1e-12, -1e-6f, AT(tanh, 0, 7));
+    TEST_ASSERT_EQUAL_FLOAT(-1.0f, AT(tanh, 0, 8));
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, AT(tanh, 0, 9));
+    TEST_ASSERT_FLOAT_WITHIN(1e-30, 0.0f, AT(exp, 0, 10));
+    TEST_ASSERT_FALSE(isnan(AT(exp, 0, 9)));
+
+    mx_free(m);
+    mx_free(log);
+    mx_free(tanh);
+    mx_free(exp);
+}
+
+void test_apply_op_strided_and_invalid(void) {
+    Matrix* m = mx_arrange_alloc(3, 4, -5);
+    Matrix* t = TRANSPOSE_VIEW(m);
+
+    TEST_ASSERT_EQUAL(0, APPLY_OP(t, MX_OP_RELU));
+    TEST_ASSERT_EQUAL_FLOAT(0, AT(m, 0, 0));
+    TEST_ASSERT_EQUAL_FLOAT(0, AT(m, 1, 0));
+    TEST_ASSERT_EQUAL_FLOAT(1, AT(m, 1, 2));
+    TEST_ASSERT_EQUAL_FLOAT(6, AT(m, 2, 3));
+
+    Matrix* other = MATRIX(3, 4);
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_apply_op(m, m, t, MX_OP_ADD, 0, 0));
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_apply_op(m, m, NULL, MX_OP_MUL, 0, 0));
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_apply_op(m, m, other, MX_OP_COUNT, 0, 0));
+    TEST_ASSERT_EQUAL(0, CLAMP(m, 1, 2));
+    TEST_ASSERT_EQUAL_FLOAT(1, AT(m, 0, 0));
+    TEST_ASSERT_EQUAL_FLOAT(2, AT(m, 2, 3));
+
+    mx_free(other);
+    mx_free(t);
+    mx_free(m);
+}
+
+void test_dense_forward_matches_unfused(void) {
+    // 150 x 70 x 90 takes the packed GEMM path, 5 x 4 x 3 the small one, the last two the GEMV kernels
+    size_t shapes[4][3] = {{150, 70, 90}, {5, 4, 3}, {1, 70, 90}, {150, 70, 1}};
+    mx_op activations[] = {MX_OP_SIGMOID, MX_OP_TANH, MX_OP_RELU, MX_OP_IDENTITY};
+
+    for (size_t s = 0; s < 4; s++) {
+        Matrix* input = MATRIX(shapes[s][0], shapes[s][1]);
+        Matrix* weights = MATRIX(shapes[s][1], shapes[s][2]);
+        Matrix* bias = MATRIX(1, shapes[s][2]);
+        fill_pattern(input, 31);
+        fill_pattern(weights, 32);
+        fill_pattern(bias, 33);
+        Matrix* fused = MATRIX(shapes[s][0], shapes[s][2]);
+        Matrix* unfused = MATRIX(shapes[s][0], shapes[s][2]);
+
+        for (size_t a = 0; a < 4; a++) {
+            TEST_ASSERT_EQUAL(0, mx_dense_forward(fused, input, weights, bias, activations[a]));
+            DOT(unfused, input, weights);
+            for (size_t i = 0; i < unfused->rows; i++) {
+                for (size_t j = 0; j < unfused->cols; j++) {
+                    AT(unfused, i, j) += AT(bias, 0, j);
+                }
+            }
+            APPLY_OP(unfused, activations[a]);
+            for (size_t i = 0; i < fused->rows; i++) {
+                for (size_t j = 0; j < fused->cols; j++) {
+                    TEST_ASSERT_FLOAT_WITHIN(1e-5, AT(unfused, i, j), AT(fused, i, j));
+                }
+            }
+        }
+
+        mx_free(input);
+        mx_free(weights);
+        mx_free(bias);
+        mx_free(fused);
+        mx_free(unfused);
+    }
+}
+
+void test_dense_forward_invalid_arguments(void) {
+    Matrix* input = MATRIX(2, 3);
+    Matrix* weights = MATRIX(3, 4);
+    Matrix* output = MATRIX(2, 4);
+    Matrix* wrong_bias = MATRIX(1, 3);
+    Matrix* bias_column = MATRIX_WITH(4, 1, 1.0f);
+
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_dense_forward(output, weights, input, NULL, MX_OP_RELU));
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_dense_forward(output, input, weights, wrong_bias, MX_OP_RELU));
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_dense_forward(output, input, weights, NULL, MX_OP_ADD));
+    TEST_ASSERT_EQUAL(0, mx_dense_forward(output, input, weights, bias_column, MX_OP_IDENTITY));
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, AT(output, 1, 3));
+
+    mx_free(input);
+    mx_free(weights);
+    mx_free(output);
+    mx_free(wrong_bias);
+    mx_free(bias_column);
+}
+
 void test_slice_valid_submatrix(void) {
     Matrix* matrix = mx_arrange_alloc(4, 4, 1); // Produces a 4x4 matrix with values from 1 to 16
 
@@ -709,6 +1220,48 @@ void test_slice_single_row_col(void) {
     mx_free(row_slice);
     mx_free(col_slice);
 }
+
+void test_slice_is_view(void) {
+    Matrix* matrix = mx_arrange_alloc(6, 5, 1);
+    Matrix* slice = mx_slice(matrix, 1, 4, 2, 3);
+    TEST_ASSERT_TRUE(slice->container == matrix->container);
+    TEST_ASSERT_EQUAL_UINT(2, matrix->container->ref_count);
+
+    // writes through the slice land in the parent, slices of slices keep offsetting
+    AT(slice, 1, 0) = -1;
+    TEST_ASSERT_EQUAL_FLOAT(-1, AT(matrix, 2, 2));
+    Matrix* inner = mx_slice(slice, 2, 3, 1, 1);
+    TEST_ASSERT_EQUAL_FLOAT(AT(matrix, 3, 3), AT(inner, 0, 0));
+    TEST_ASSERT_EQUAL_FLOAT(AT(matrix, 4, 3), AT(inner, 1, 0));
+
+    // kernels see only the slice
+    Matrix* product = MATRIX(4, 4);
+    Matrix* slice_t = TRANSPOSE_VIEW(slice);
+    DOT(product, slice, slice_t);
+    TEST_ASSERT_EQUAL_FLOAT(reference_dot_at(slice, slice_t, 3, 1), AT(product, 3, 1));
+    MULTIPLY(slice, slice);
+    TEST_ASSERT_EQUAL_FLOAT(1, AT(matrix, 2, 2));
+    TEST_ASSERT_EQUAL_FLOAT(12, AT(matrix, 2, 1));   // outside the slice
+
+    // copies are packed and independent
+    Matrix* copy = MATRIX_COPY(slice);
+    Matrix* col_copy = COL_SLICE_COPY(matrix, 3, 3);
+    TEST_ASSERT_EQUAL_UINT(2, copy->row_stride);
+    TEST_ASSERT_TRUE(mx_equal(copy, slice));
+    AT(matrix, 0, 3) = 100;
+    TEST_ASSERT_EQUAL_FLOAT(4, AT(col_copy, 0, 0));
+
+    // the container lives until the last view is gone
+    mx_free(matrix);
+    mx_free(slice_t);
+    mx_free(slice);
+    TEST_ASSERT_EQUAL_FLOAT(AT(copy, 3, 1), AT(inner, 1, 0));
+    mx_free(inner);
+    mx_free(product);
+    mx_free(copy);
+    mx_free(col_copy);
+}
+
 void test_AT_macro(void) {
     Matrix* matrix = MATRIX(3, 3); // 3x3 matrix with zeroes
     AT(matrix, 1, 1) = 5;
@@ -727,6 +1280,31 @@ void test_MATRIX_macro(void) {
     mx_free(matrix);
 }
 
+void test_MATRIX_macro_large_dimensions(void) {
+    // dimensions and strides above the old 16-bit limit
+    Matrix* matrix = MATRIX_WITH(2, 70000, 1.0f);
+
+    TEST_ASSERT_NOT_NULL(matrix);
+    TEST_ASSERT_EQUAL_UINT64(70000, matrix->cols);
+    TEST_ASSERT_EQUAL_UINT64(70000, matrix->row_stride);
+    AT(matrix, 1, 69999) = 3.0f;
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, matrix->container->data[2 * 70000 - 1]);
+
+    Matrix* transposed = TRANSPOSE_VIEW(matrix);
+    TEST_ASSERT_EQUAL_UINT64(70000, transposed->rows);
+    TEST_ASSERT_EQUAL_UINT64(70000, transposed->col_stride);
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, AT(transposed, 69999, 1));
+
+    Matrix* dot = MATRIX(2, 2);
+    DOT(dot, matrix, transposed);
+    TEST_ASSERT_EQUAL_FLOAT(70000.0f, AT(dot, 0, 0));
+    TEST_ASSERT_EQUAL_FLOAT(70002.0f, AT(dot, 1, 0));
+
+    mx_free(dot);
+    mx_free(transposed);
+    mx_free(matrix);
+}
+
 void test_MATRIX_VIEW_macro(void) {
     Matrix* original = MATRIX(3, 3);
     Matrix* view = MATRIX_VIEW(original);
@@ -1006,7 +1584,7 @@ void test_MATRIX_ONES_metadata(void) {
 
 void test_mx_view_ref_count_increase(void) {
     Matrix* original = MATRIX(3, 3);
-    uint16_t initial_ref_count = original->container->ref_count;
+    size_t initial_ref_count = original->container->ref_count;
     
     Matrix* view = mx_view(original, 3, 3, 1);
     TEST_ASSERT_EQUAL_UINT(initial_ref_count + 1, original->container->ref_count);
@@ -1086,6 +1664,250 @@ void test_init_matrix_with_dynamic_array(void) {
     }
 }
 
+void test_matrix_wrap_borrows_buffer(void) {
+    float data[6] = {1, 2, 3, 4, 5, 6};
+    Matrix* m = MATRIX_WRAP(data, 2, 3);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_TRUE(m->container->data == data);
+    TEST_ASSERT_EQUAL_FLOAT(6, AT(m, 1, 2));
+
+    // writes go straight to the caller's buffer, views share it
+    AT(m, 0, 1) = 20;
+    TEST_ASSERT_EQUAL_FLOAT(20, data[1]);
+    Matrix* t = TRANSPOSE_VIEW(m);
+    TEST_ASSERT_EQUAL_FLOAT(20, AT(t, 1, 0));
+    mx_free(m);
+    mx_free(t);
+
+    // the buffer outlives the matrix
+    TEST_ASSERT_EQUAL_FLOAT(5, data[4]);
+    TEST_ASSERT_NULL(MATRIX_WRAP(NULL, 2, 3));
+    TEST_ASSERT_NULL(MATRIX_WRAP(data, 0, 3));
+}
+
+void test_matrix_single_allocation(void) {
+    Matrix* m = MATRIX(3, 5);
+    TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)m->container->data % 64);
+    fill_pattern(m, 26);
+
+    // views keep the shared block alive after the owner is freed
+    Matrix* view = MATRIX_VIEW(m);
+    float first = AT(m, 0, 0);
+    mx_free(m);
+    TEST_ASSERT_EQUAL_FLOAT(first, AT(view, 0, 0));
+    mx_free(view);
+}
+
+void test_matrix_padded_rows(void) {
+    Matrix* padded = MATRIX_PADDED(7, 21);
+    TEST_ASSERT_NOT_NULL(padded);
+    TEST_ASSERT_EQUAL_UINT(0, padded->row_stride % (64 / sizeof(precision_type)));
+    TEST_ASSERT_TRUE(padded->row_stride >= 21);
+    for (size_t i = 0; i < padded->rows; i++) {
+        TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)&AT(padded, i, 0) % 64);
+    }
+
+    // kernels give the same results as on a dense matrix and leave the padding alone
+    Matrix* dense = MATRIX(7, 21);
+    fill_pattern(dense, 27);
+    for (size_t i = 0; i < 7; i++) {
+        for (size_t j = 0; j < 21; j++) {
+            AT(padded, i, j) = AT(dense, i, j);
+        }
+    }
+    APPLY_OP(padded, MX_OP_EXP);
+    APPLY_OP(dense, MX_OP_EXP);
+    TEST_ASSERT_TRUE(mx_equal(dense, padded));
+    TEST_ASSERT_EQUAL_FLOAT(0, padded->container->data[padded->row_stride - 1]);
+
+    Matrix* dense_t = TRANSPOSE_VIEW(dense);
+    Matrix* from_padded = MATRIX(7, 7);
+    Matrix* from_dense = MATRIX(7, 7);
+    DOT(from_padded, padded, dense_t);
+    DOT(from_dense, dense, dense_t);
+    TEST_ASSERT_TRUE(mx_equal(from_dense, from_padded));
+
+    Matrix* copy = MATRIX_COPY(padded);
+    TEST_ASSERT_EQUAL_UINT(21, copy->row_stride);
+    TEST_ASSERT_TRUE(mx_equal(copy, padded));
+
+    mx_free(padded);
+    mx_free(dense);
+    mx_free(dense_t);
+    mx_free(from_padded);
+    mx_free(from_dense);
+    mx_free(copy);
+}
+
+static size_t wrap_releases = 0;
+
+static void count_release(precision_type* data, void* ctx) {
+    TEST_ASSERT_TRUE(ctx == &wrap_releases);
+    wrap_releases++;
+    free(data);
+}
+
+void test_matrix_wrap_release_callback(void) {
+    float* data = malloc(8 * sizeof(float));
+    TEST_ASSERT_NOT_NULL(data);
+    Matrix* m = mx_wrap(data, 4, 2, count_release, &wrap_releases);
+    TEST_ASSERT_NOT_NULL(m);
+    Matrix* view = MATRIX_VIEW(m);
+    mx_free(m);
+    TEST_ASSERT_EQUAL_UINT(0, wrap_releases);
+    mx_free(view);
+    TEST_ASSERT_EQUAL_UINT(1, wrap_releases);
+}
+
+void test_arena_temporaries(void) {
+    size_t arch[] = {3, 5, 2};
+    NN* nn = NN(arch);
+    mx_arena* arena = mx_arena_new(4096);
+    TEST_ASSERT_NOT_NULL(arena);
+
+    mx_arena_begin(arena);
+    Matrix* a = MATRIX(4, 4);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_EQUAL_FLOAT(0, AT(a, 3, 3));
+    fill_pattern(a, 25);
+    Matrix* scaled = mx_scale(a, 2);
+    Matrix* big = MATRIX(64, 64);   // larger than a block, gets one of its own
+    TEST_ASSERT_NOT_NULL(big);
+    TEST_ASSERT_EQUAL_FLOAT(2 * AT(a, 1, 2), AT(scaled, 1, 2));
+    mx_free(scaled);                 // allowed, and a no-op
+    TEST_ASSERT_EQUAL(0, mx_nn_set_batch(nn, 8));
+    mx_arena_end();
+
+    // matrices created outside the scope are plain heap allocations
+    Matrix* heap = MATRIX(2, 2);
+
+    // after a reset the same memory is handed out again, zeroed
+    mx_arena_reset(arena);
+    mx_arena_begin(arena);
+    Matrix* b = MATRIX(4, 4);
+    TEST_ASSERT_TRUE(b == a);
+    TEST_ASSERT_EQUAL_FLOAT(0, AT(b, 1, 2));
+    mx_arena_end();
+    mx_arena_reset(arena);
+
+    // the activations resized inside the scope still belong to the network
+    TEST_ASSERT_EQUAL_UINT(8, nn->as[2]->rows);
+    AT(nn->as[2], 7, 1) = 1;
+    mx_nn_free(nn);
+    mx_free(heap);
+    mx_arena_free(arena);
+}
+
+static void* begin_arena_elsewhere(void* arena) {
+    static uint8_t status;
+    status = mx_arena_begin(arena);
+    if (status == 0) {
+        mx_arena_end();
+    }
+    return &status;
+}
+
+void test_arena_nested_scopes(void) {
+    mx_arena* outer = mx_arena_new(4096);
+    mx_arena* inner = mx_arena_new(4096);
+    Matrix* heap = MATRIX(2, 2);
+
+    TEST_ASSERT_EQUAL(0, mx_arena_begin(outer));
+    Matrix* a = MATRIX(4, 4);
+    TEST_ASSERT_EQUAL(0, mx_arena_begin(inner));
+    Matrix* b = MATRIX(4, 4);
+    mx_free(a);                      // owned by the outer scope, a no-op
+    mx_arena_end();
+    // back in the outer arena, right after a
+    mx_arena_reset(inner);
+    Matrix* c = MATRIX(4, 4);
+    mx_arena_end();
+    TEST_ASSERT_TRUE(b != a && c != a);
+    mx_arena_reset(outer);
+    mx_arena_begin(outer);
+    TEST_ASSERT_TRUE(MATRIX(4, 4) == a);
+    TEST_ASSERT_TRUE(MATRIX(4, 4) == c);
+
+    // the same arena again, and a heap matrix freed from inside both scopes
+    TEST_ASSERT_EQUAL(0, mx_arena_begin(outer));
+    Matrix* d = MATRIX(4, 4);
+    mx_free(d);
+    mx_free(heap);
+
+    // an arena is used by one thread at a time
+    pthread_t thread;
+    void* status;
+    pthread_create(&thread, NULL, begin_arena_elsewhere, outer);
+    pthread_join(thread, &status);
+    TEST_ASSERT_EQUAL((uint8_t)-1, *(uint8_t*)status);
+    mx_arena_end();
+    mx_arena_end();
+    pthread_create(&thread, NULL, begin_arena_elsewhere, outer);
+    pthread_join(thread, &status);
+    TEST_ASSERT_EQUAL(0, *(uint8_t*)status);
+
+    // outside of every scope, matrices come from the heap again
+    Matrix* e = MATRIX(2, 2);
+    mx_free(e);
+    mx_arena_free(outer);
+    mx_arena_free(inner);
+}
+
+void test_arena_nn_resized_in_scope(void) {
+    // the activations of a network built inside a scope are arena memory; growing them
+    // must drop the old ones back to the arena, not to the heap
+    size_t arch[] = {3, 5, 2};
+    mx_arena* arena = mx_arena_new(4096);
+    TEST_ASSERT_EQUAL(0, mx_arena_begin(arena));
+    NN* nn = NN(arch);
+    TEST_ASSERT_NOT_NULL(nn);
+    Matrix* output = nn->as[2];
+    TEST_ASSERT_EQUAL(0, mx_nn_set_batch(nn, 8));
+    TEST_ASSERT_TRUE(output != nn->as[2]);
+    TEST_ASSERT_EQUAL_UINT(8, nn->as[2]->rows);
+    mx_nn_forward(nn);
+    AT(nn->as[2], 7, 1) = 1;
+    TEST_ASSERT_EQUAL(0, mx_nn_set_batch(nn, 2));
+    mx_nn_free(nn);
+    mx_arena_end();
+    mx_arena_free(arena);
+}
+
+void test_buffer_pool_steady_state(void) {
+    Matrix* a = MATRIX(70, 40);
+    Matrix* b = MATRIX(40, 50);
+    fill_pattern(a, 28);
+    fill_pattern(b, 29);
+    mx_buffer_pool_enable(1);
+
+    // the first step allocates every size once, later steps only recycle
+    size_t misses = 0;
+    for (size_t step = 0; step < 5; step++) {
+        Matrix* product = MATRIX(70, 50);
+        DOT(product, a, b);
+        Matrix* copy = MATRIX_COPY(product);
+        Matrix* view = MATRIX_VIEW(copy);
+        TEST_ASSERT_EQUAL_FLOAT(reference_dot_at(a, b, 69, 49), AT(copy, 69, 49));
+        mx_free(product);
+        mx_free(copy);
+        mx_free(view);
+        if (step == 0) {
+            misses = mx_buffer_pool_get_stats().misses;
+        }
+    }
+    mx_buffer_pool_stats stats = mx_buffer_pool_get_stats();
+    TEST_ASSERT_EQUAL_UINT(misses, stats.misses);
+    TEST_ASSERT_TRUE(stats.hits >= 4 * misses);
+    TEST_ASSERT_TRUE(stats.cached > 0);
+
+    mx_buffer_pool_enable(0);
+    stats = mx_buffer_pool_get_stats();
+    TEST_ASSERT_EQUAL_UINT(0, stats.cached);
+    TEST_ASSERT_EQUAL_UINT(0, stats.cached_bytes);
+    mx_free(a);
+    mx_free(b);
+}
+
 void test_self_dot_product_with_valid_row_vector(void) {
     float data[3] = {1.0, 2.0, 3.0};
     Matrix *row_vector = MATRIX_FROM(data, 1, 3);
@@ -1195,6 +2017,450 @@ void test_invalid_matrix_dimensions(void) {
     TEST_ASSERT_NULL(n);
 }
 
+void test_small_matrix_ops(void) {
+    mx_mat4 a = {{{2, 0, 1, 3}, {1, 4, 0, 2}, {0, 1, 5, 1}, {3, 2, 1, 6}}};
+    mx_mat4 inv;
+    TEST_ASSERT_EQUAL(0, mx_mat4_inverse(a, &inv));
+    mx_mat4 product = mx_mat4_mul(a, inv);
+    mx_mat4 identity = mx_mat4_identity();
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-5, identity.m[i][j], product.m[i][j]);
+        }
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 53, mx_mat4_det(a));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 53, mx_mat4_det(mx_mat4_transpose(a)));
+
+    mx_mat3 b = {{{1, 2, 3}, {0, 1, 4}, {5, 6, 0}}};
+    mx_mat3 b_inv;
+    TEST_ASSERT_EQUAL(0, mx_mat3_inverse(b, &b_inv));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 1, mx_mat3_det(b));
+    // the inverse of this matrix has integer entries
+    mx_mat3 expected = {{{-24, 18, 5}, {20, -15, -4}, {-5, 4, 1}}};
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(&expected.m[0][0], &b_inv.m[0][0], 9);
+    mx_vec3 x = {{1, 2, 3}};
+    mx_vec3 back = mx_mat3_mul_vec(b_inv, mx_mat3_mul_vec(b, x));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 2, back.v[1]);
+
+    mx_mat2 singular = {{{1, 2}, {2, 4}}};
+    mx_mat2 untouched = mx_mat2_identity();
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_mat2_inverse(singular, &untouched));
+    TEST_ASSERT_EQUAL_FLOAT(1, untouched.m[0][0]);
+
+    mx_vec3 ex = {{1, 0, 0}}, ey = {{0, 1, 0}};
+    mx_vec3 ez = mx_vec3_cross(ex, ey);
+    TEST_ASSERT_EQUAL_FLOAT(1, ez.v[2]);
+    TEST_ASSERT_EQUAL_FLOAT(0, mx_vec3_dot(ez, ex));
+    mx_vec2 v = mx_vec2_normalize((mx_vec2){{3, 4}});
+    TEST_ASSERT_EQUAL_FLOAT(0.6f, v.v[0]);
+    TEST_ASSERT_EQUAL_FLOAT(0.8f, v.v[1]);
+    mx_vec2 zero = mx_vec2_normalize((mx_vec2){{0, 0}});
+    TEST_ASSERT_EQUAL_FLOAT(0, zero.v[0]);
+}
+
+void test_small_matrix_interop(void) {
+    Matrix* m = MATRIX(3, 3);
+    fill_pattern(m, 40);
+    mx_mat3 a;
+    TEST_ASSERT_EQUAL(0, mx_mat3_load(&a, m));
+
+    // the fixed-size product matches DOT on the same values
+    Matrix* expected = MATRIX(3, 3);
+    DOT(expected, m, m);
+    mx_mat3 squared = mx_mat3_mul(a, a);
+    Matrix* result = MATRIX(3, 3);
+    TEST_ASSERT_EQUAL(0, mx_mat3_store(&squared, result));
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(expected->container->data, result->container->data, 9);
+
+    // vectors load from rows, columns and strided views alike
+    Matrix* t = TRANSPOSE_VIEW(m);
+    Matrix* col = COL_SLICE(t, 1, 1);
+    mx_vec3 row;
+    TEST_ASSERT_EQUAL(0, mx_vec3_load(&row, col));
+    for (int j = 0; j < 3; j++) {
+        TEST_ASSERT_EQUAL_FLOAT(AT(m, 1, j), row.v[j]);
+    }
+    mx_vec3 cross = mx_vec3_cross(row, row);
+    TEST_ASSERT_EQUAL(0, mx_vec3_store(&cross, col));
+    TEST_ASSERT_EQUAL_FLOAT(0, AT(m, 1, 2));
+
+    mx_mat2 too_small;
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_mat2_load(&too_small, m));
+    mx_vec4 too_large;
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_vec4_load(&too_large, col));
+
+    mx_free(col);
+    mx_free(t);
+    mx_free(m);
+    mx_free(expected);
+    mx_free(result);
+}
+
+void test_lu_solve_many_right_hand_sides(void) {
+    // 150 rows cover two full MX_LU_BLOCK panels and a partial one
+    size_t n = 150;
+    Matrix* a = MATRIX(n, n);
+    Matrix* b = MATRIX(n, 3);
+    fill_pattern(a, 41);
+    fill_pattern(b, 42);
+    Matrix* lu = MATRIX_COPY(a);
+    size_t pivots[150];
+    TEST_ASSERT_EQUAL(0, mx_lu(lu, pivots));
+
+    // the factors are reused: once for all three columns, once for a single column view
+    Matrix* x = MATRIX_COPY(b);
+    TEST_ASSERT_EQUAL(0, mx_lu_solve(lu, pivots, x));
+    Matrix* x_col = COL_SLICE_COPY(b, 2, 2);
+    TEST_ASSERT_EQUAL(0, mx_lu_solve(lu, pivots, x_col));
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < 3; j++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-3, AT(b, i, j), reference_dot_at(a, x, i, j));
+        }
+        TEST_ASSERT_FLOAT_WITHIN(1e-5, AT(x, i, 2), AT(x_col, i, 0));
+    }
+
+    Matrix* solved = mx_solve(a, b);
+    TEST_ASSERT_NOT_NULL(solved);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(x->container->data, solved->container->data, n * 3);
+
+    mx_free(a);
+    mx_free(b);
+    mx_free(lu);
+    mx_free(x);
+    mx_free(x_col);
+    mx_free(solved);
+}
+
+void test_lu_pivoting_and_singular(void) {
+    // a tiny leading entry needs a row swap; Gauss-Jordan without pivoting rejected it
+    float arr[] = {1e-8f, 1, 1, 1};
+    Matrix* a = MATRIX_FROM(arr, 2, 2);
+    Matrix* inv = MATRIX(2, 2);
+    TEST_ASSERT_EQUAL(1, mx_inverse(a, inv));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, -1, AT(inv, 0, 0));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 1, AT(inv, 0, 1));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 1, AT(inv, 1, 0));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 0, AT(inv, 1, 1));
+    // the input is left as it was
+    TEST_ASSERT_EQUAL_FLOAT(1e-8f, AT(a, 0, 0));
+
+    float singular_arr[] = {1, 2, 3, 2, 4, 6, 1, 0, 1};
+    Matrix* singular = MATRIX_FROM(singular_arr, 3, 3);
+    Matrix* rhs = MATRIX_WITH(3, 1, 1);
+    TEST_ASSERT_NULL(mx_solve(singular, rhs));
+    TEST_ASSERT_NULL(mx_solve(a, rhs));
+
+    mx_free(a);
+    mx_free(inv);
+    mx_free(singular);
+    mx_free(rhs);
+}
+
+void test_cholesky_solve(void) {
+    // A = M M^T + n I is positive definite; 150 rows cover three MX_LU_BLOCK panels
+    size_t n = 150;
+    Matrix* m = MATRIX(n, n);
+    fill_pattern(m, 43);
+    Matrix* m_t = TRANSPOSE_VIEW(m);
+    Matrix* a = MATRIX(n, n);
+    DOT(a, m, m_t);
+    for (size_t i = 0; i < n; i++) {
+        AT(a, i, i) += n;
+    }
+
+    Matrix* l = MATRIX_COPY(a);
+    TEST_ASSERT_EQUAL(0, mx_cholesky(l));
+    Matrix* l_t = TRANSPOSE_VIEW(l);
+    // nothing is left above the diagonal, inside a diagonal block or outside
+    TEST_ASSERT_EQUAL_FLOAT(0, AT(l, 10, 11));
+    TEST_ASSERT_EQUAL_FLOAT(0, AT(l, 0, n - 1));
+    for (size_t i = 0; i < n; i += 7) {
+        for (size_t j = 0; j < n; j += 5) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-3, AT(a, i, j), reference_dot_at(l, l_t, i, j));
+        }
+    }
+
+    Matrix* b = MATRIX(n, 2);
+    fill_pattern(b, 44);
+    Matrix* x = mx_spd_solve(a, b);
+    TEST_ASSERT_NOT_NULL(x);
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(1e-3, AT(b, i, 0), reference_dot_at(a, x, i, 0));
+        TEST_ASSERT_FLOAT_WITHIN(1e-3, AT(b, i, 1), reference_dot_at(a, x, i, 1));
+    }
+
+    // symmetric but indefinite
+    float arr[] = {1, 2, 2, 1};
+    Matrix* indefinite = MATRIX_FROM(arr, 2, 2);
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_cholesky(indefinite));
+
+    mx_free(m);
+    mx_free(m_t);
+    mx_free(a);
+    mx_free(l);
+    mx_free(l_t);
+    mx_free(b);
+    mx_free(x);
+    mx_free(indefinite);
+}
+
+void test_triangular_kernels(void) {
+    // 150 rows split down to several leaves; the half of a that is not named holds NaN,
+    // so reading it would show up in every result
+    size_t n = 150, k = 5;
+    for (int flags = 0; flags <= (MX_UPPER | MX_UNIT_DIAGONAL | MX_RIGHT); flags++) {
+        Matrix* a = MATRIX(n, n);
+        Matrix* t = MATRIX(n, n);
+        fill_pattern(a, 52 + flags);
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j < n; j++) {
+                uint8_t inside = flags & MX_UPPER ? j >= i : j <= i;
+                if (i == j) {
+                    AT(a, i, i) = flags & MX_UNIT_DIAGONAL ? NAN : 2 + AT(a, i, i);
+                    AT(t, i, i) = flags & MX_UNIT_DIAGONAL ? 1 : AT(a, i, i);
+                }
+                else if (inside) {
+                    AT(a, i, j) /= n;
+                    AT(t, i, j) = AT(a, i, j);
+                }
+                else {
+                    AT(a, i, j) = NAN;
+                }
+            }
+        }
+        Matrix* b = flags & MX_RIGHT ? MATRIX(k, n) : MATRIX(n, k);
+        fill_pattern(b, 60 + flags);
+        Matrix* x = MATRIX_COPY(b);
+
+        // t * b (or b * t) against the dense reference, then back to b
+        TEST_ASSERT_EQUAL(0, mx_trmm(a, x, flags));
+        for (size_t i = 0; i < b->rows; i++) {
+            for (size_t j = 0; j < b->cols; j++) {
+                float expected = flags & MX_RIGHT ? reference_dot_at(b, t, i, j) : reference_dot_at(t, b, i, j);
+                TEST_ASSERT_FLOAT_WITHIN(1e-4, expected, AT(x, i, j));
+            }
+        }
+        TEST_ASSERT_EQUAL(0, mx_trsm(a, x, flags));
+        for (size_t i = 0; i < b->rows; i++) {
+            for (size_t j = 0; j < b->cols; j++) {
+                TEST_ASSERT_FLOAT_WITHIN(1e-4, AT(b, i, j), AT(x, i, j));
+            }
+        }
+
+        // the operand must match the side
+        Matrix* wrong = flags & MX_RIGHT ? MATRIX(n, k) : MATRIX(k, n);
+        TEST_ASSERT_EQUAL((uint8_t)-1, mx_trsm(a, wrong, flags));
+        TEST_ASSERT_EQUAL((uint8_t)-1, mx_trmm(a, wrong, flags));
+
+        mx_free(a);
+        mx_free(t);
+        mx_free(b);
+        mx_free(x);
+        mx_free(wrong);
+    }
+}
+
+void test_qr_factorization(void) {
+    // 150x70 spans three MX_QR_BLOCK panels, the last one partial
+    size_t m = 150, n = 70;
+    Matrix* a = MATRIX(m, n);
+    fill_pattern(a, 45);
+    Matrix* qr = MATRIX_COPY(a);
+    float tau[70];
+    TEST_ASSERT_EQUAL(0, mx_qr(qr, tau));
+
+    // Q^T A reproduces R on and above the diagonal and vanishes below it
+    Matrix* qta = MATRIX_COPY(a);
+    TEST_ASSERT_EQUAL(0, mx_qr_apply_qt(qr, tau, qta));
+    for (size_t i = 0; i < m; i += 3) {
+        for (size_t j = 0; j < n; j++) {
+            float expected = i <= j ? AT(qr, i, j) : 0;
+            TEST_ASSERT_FLOAT_WITHIN(1e-4, expected, AT(qta, i, j));
+        }
+    }
+
+    Matrix* wide = MATRIX(3, 4);
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_qr(wide, tau));
+
+    mx_free(a);
+    mx_free(qr);
+    mx_free(qta);
+    mx_free(wide);
+}
+
+void test_lstsq(void) {
+    size_t m = 200, n = 40;
+    Matrix* a = MATRIX(m, n);
+    fill_pattern(a, 46);
+    Matrix* x = MATRIX(n, 1);
+    fill_pattern(x, 47);
+
+    // b = A x + r with r out of the column space: the second column gets A x back exactly
+    Matrix* b = MATRIX(m, 2);
+    fill_pattern(b, 48);
+    for (size_t i = 0; i < m; i++) {
+        AT(b, i, 1) = reference_dot_at(a, x, i, 0);
+    }
+    Matrix* solution = mx_lstsq(a, b);
+    TEST_ASSERT_NOT_NULL(solution);
+    TEST_ASSERT_EQUAL(n, solution->rows);
+    TEST_ASSERT_EQUAL(2, solution->cols);
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, AT(x, i, 0), AT(solution, i, 1));
+    }
+
+    // the least-squares residual of the first column is orthogonal to the columns of A
+    Matrix* residual = MATRIX(m, 1);
+    for (size_t i = 0; i < m; i++) {
+        AT(residual, i, 0) = AT(b, i, 0) - reference_dot_at(a, solution, i, 0);
+    }
+    Matrix* a_t = TRANSPOSE_VIEW(a);
+    for (size_t j = 0; j < n; j++) {
+        TEST_ASSERT_FLOAT_WITHIN(1e-3, 0, reference_dot_at(a_t, residual, j, 0));
+    }
+
+    // more unknowns than equations, and a rank-deficient A
+    Matrix* wide = MATRIX(3, 4);
+    Matrix* rhs = MATRIX(3, 1);
+    TEST_ASSERT_NULL(mx_lstsq(wide, rhs));
+    Matrix* zero = MATRIX(3, 2);
+    TEST_ASSERT_NULL(mx_lstsq(zero, rhs));
+
+    // columns that are dependent up to rounding leave a tiny, not a zero, R diagonal
+    Matrix* collinear = MATRIX_COPY(a);
+    for (size_t i = 0; i < m; i++) {
+        AT(collinear, i, n - 1) = AT(a, i, 3) + 1e-6f * AT(a, i, 5);
+        AT(collinear, i, n - 2) = 2 * AT(a, i, 7);
+    }
+    TEST_ASSERT_NULL(mx_lstsq(collinear, b));
+    for (size_t i = 0; i < m; i++) {
+        AT(collinear, i, n - 2) = AT(a, i, n - 2);
+    }
+    TEST_ASSERT_NULL(mx_lstsq(collinear, b));
+
+    mx_free(a);
+    mx_free(x);
+    mx_free(b);
+    mx_free(solution);
+    mx_free(residual);
+    mx_free(a_t);
+    mx_free(wide);
+    mx_free(rhs);
+    mx_free(zero);
+    mx_free(collinear);
+}
+
+void test_symmetric_eigen(void) {
+    size_t n = 150;
+    Matrix* a = MATRIX(n, n);
+    fill_pattern(a, 49);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < i; j++) {
+            AT(a, j, i) = AT(a, i, j);
+        }
+    }
+    float w[150];
+    Matrix* v = MATRIX(n, n);
+    TEST_ASSERT_EQUAL(0, mx_eigh(a, w, v));
+    Matrix* v_t = TRANSPOSE_VIEW(v);
+    for (size_t c = 0; c < n; c += 7) {
+        if (c > 0) {
+            TEST_ASSERT_TRUE(w[c - 1] <= w[c]);
+        }
+        // A v = w v, and the eigenvectors are orthonormal
+        for (size_t i = 0; i < n; i += 3) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-4, w[c] * AT(v, i, c), reference_dot_at(a, v, i, c));
+            TEST_ASSERT_FLOAT_WITHIN(1e-4, i == c ? 1 : 0, reference_dot_at(v_t, v, i, c));
+        }
+    }
+
+    // already diagonal: nothing to reduce, only to sort
+    float arr[] = {3, 0, 0,
+                   0, 1, 0,
+                   0, 0, 2};
+    Matrix* diagonal = MATRIX_FROM(arr, 3, 3);
+    Matrix* axes = MATRIX(3, 3);
+    TEST_ASSERT_EQUAL(0, mx_eigh(diagonal, w, axes));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 1, w[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 2, w[1]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 3, w[2]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 1, fabsf(AT(axes, 1, 0)));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 1, fabsf(AT(axes, 2, 1)));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 1, fabsf(AT(axes, 0, 2)));
+
+    // eigenvalues only
+    float arr2[] = {2, 1, 1, 2};
+    Matrix* pair = MATRIX_FROM(arr2, 2, 2);
+    TEST_ASSERT_EQUAL(0, mx_eigh(pair, w, NULL));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 1, w[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 3, w[1]);
+
+    Matrix* rectangular = MATRIX(3, 2);
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_eigh(rectangular, w, NULL));
+
+    mx_free(a);
+    mx_free(v);
+    mx_free(v_t);
+    mx_free(diagonal);
+    mx_free(axes);
+    mx_free(pair);
+    mx_free(rectangular);
+}
+
+void test_truncated_svd(void) {
+    // A = X D Y has rank 8 with a decaying spectrum, within reach of the oversampled sketch
+    size_t m = 300, n = 90, r = 8, k = 3;
+    Matrix* x = MATRIX(m, r);
+    Matrix* y = MATRIX(r, n);
+    fill_pattern(x, 50);
+    fill_pattern(y, 51);
+    for (size_t i = 0; i < r; i++) {
+        for (size_t j = 0; j < n; j++) {
+            AT(y, i, j) *= (float)(1 << (r - i));
+        }
+    }
+    Matrix* a = MATRIX(m, n);
+    DOT(a, x, y);
+
+    Matrix* u = MATRIX(m, k);
+    Matrix* v = MATRIX(n, k);
+    float s[3];
+    TEST_ASSERT_EQUAL(0, mx_svd_truncated(a, k, u, s, v));
+
+    // the singular values are the square roots of the top eigenvalues of A^T A
+    Matrix* a_t = TRANSPOSE_VIEW(a);
+    Matrix* gram = MATRIX(n, n);
+    DOT(gram, a_t, a);
+    float w[90];
+    TEST_ASSERT_EQUAL(0, mx_eigh(gram, w, NULL));
+    for (size_t i = 0; i < k; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(1e-3 * s[0], sqrtf(w[n - 1 - i]), s[i]);
+    }
+
+    // A v = s u, with orthonormal u
+    Matrix* u_t = TRANSPOSE_VIEW(u);
+    for (size_t c = 0; c < k; c++) {
+        for (size_t i = 0; i < m; i += 5) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-3 * s[0], s[c] * AT(u, i, c), reference_dot_at(a, v, i, c));
+        }
+        for (size_t j = 0; j < k; j++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-4, j == c ? 1 : 0, reference_dot_at(u_t, u, j, c));
+        }
+    }
+
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_svd_truncated(a, 0, NULL, s, NULL));
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_svd_truncated(a, k, v, s, NULL));
+
+    mx_free(x);
+    mx_free(y);
+    mx_free(a);
+    mx_free(u);
+    mx_free(v);
+    mx_free(a_t);
+    mx_free(gram);
+    mx_free(u_t);
+}
+
 void test_cosine_of_orthogonal_vectors(void) {
     Matrix* m = MATRIX(3,1);
     AT(m,0,0) = 1;
@@ -1708,6 +2974,165 @@ void learn(NN* m, NN* g, float rate){
     }
 }
 
+void test_nn_backprop_matches_finite_difference(void){
+    size_t arch[] = {3,4,2};
+    NN* nn = NN(arch);
+    NN* grad = NN(arch);
+    for(size_t l = 0; l < nn->count; ++l){
+        fill_pattern(nn->ws[l], 40 + l);
+        fill_pattern(nn->bs[l], 50 + l);
+    }
+    Matrix* ti = MATRIX(5, 3);
+    Matrix* to = MATRIX(5, 2);
+    fill_pattern(ti, 60);
+    fill_pattern(to, 61);
+
+    TEST_ASSERT_EQUAL(0, mx_nn_backprop(nn, grad, ti, to));
+
+    // central differences on every weight and bias
+    float eps = 1e-2f;
+    for(size_t l = 0; l < nn->count; ++l){
+        Matrix* params[2] = {nn->ws[l], nn->bs[l]};
+        Matrix* grads[2] = {grad->ws[l], grad->bs[l]};
+        for(size_t p = 0; p < 2; ++p){
+            for(size_t i = 0; i < params[p]->rows; ++i){
+                for(size_t j = 0; j < params[p]->cols; ++j){
+                    float saved = AT(params[p], i, j);
+                    AT(params[p], i, j) = saved + eps;
+                    float plus = mx_nn_cost(nn, ti, to);
+                    AT(params[p], i, j) = saved - eps;
+                    float minus = mx_nn_cost(nn, ti, to);
+                    AT(params[p], i, j) = saved;
+                    TEST_ASSERT_FLOAT_WITHIN(1e-3, (plus - minus)/(2*eps), AT(grads[p], i, j));
+                }
+            }
+        }
+    }
+
+    // a step against the gradient lowers the cost
+    float before = mx_nn_cost(nn, ti, to);
+    mx_nn_learn(nn, grad, 0.1f);
+    TEST_ASSERT_TRUE(mx_nn_cost(nn, ti, to) < before);
+
+    mx_nn_free(nn);
+    mx_nn_free(grad);
+    mx_free(ti);
+    mx_free(to);
+}
+
+void test_nn_backprop_invalid_data(void){
+    size_t arch[] = {2,3,1};
+    size_t other_arch[] = {2,2,1};
+    NN* nn = NN(arch);
+    NN* grad = NN(other_arch);
+    NN* same = NN(arch);
+    Matrix* ti = MATRIX(4, 2);
+    Matrix* to = MATRIX(3, 1);
+    Matrix* wide = MATRIX(4, 2);
+    Matrix* target = MATRIX(4, 1);
+
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_nn_backprop(nn, same, ti, to));
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_nn_backprop(nn, same, ti, wide));
+    TEST_ASSERT_EQUAL_FLOAT(-1, mx_nn_cost(nn, ti, to));
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_nn_backprop(nn, grad, ti, target));
+    TEST_ASSERT_EQUAL(0, mx_nn_backprop(nn, same, ti, target));
+
+    mx_nn_free(nn);
+    mx_nn_free(grad);
+    mx_nn_free(same);
+    mx_free(ti);
+    mx_free(to);
+    mx_free(wide);
+    mx_free(target);
+}
+
+void test_nn_forward_batch_matches_single_samples(void){
+    size_t arch[] = {5,7,3};
+    NN* nn = NN(arch);
+    for(size_t l = 0; l < nn->count; ++l){
+        fill_pattern(nn->ws[l], 70 + l);
+        fill_pattern(nn->bs[l], 80 + l);
+    }
+    Matrix* input = MATRIX(9, 5);
+    fill_pattern(input, 90);
+
+    TEST_ASSERT_EQUAL(0, mx_nn_forward_batch(nn, input));
+    Matrix* batched = MATRIX_COPY(nn->as[nn->count]);
+    TEST_ASSERT_EQUAL_UINT64(9, batched->rows);
+
+    Matrix* output = nn->as[nn->count];
+    TEST_ASSERT_EQUAL(0, mx_nn_set_batch(nn, 1));
+    TEST_ASSERT_TRUE(output == nn->as[nn->count]); // shrinking keeps the buffers
+    for(size_t i = 0; i < input->rows; ++i){
+        for(size_t j = 0; j < input->cols; ++j){
+            AT(nn->as[0], 0, j) = AT(input, i, j);
+        }
+        mx_nn_forward(nn);
+        for(size_t j = 0; j < batched->cols; ++j){
+            TEST_ASSERT_FLOAT_WITHIN(1e-6, AT(nn->as[nn->count], 0, j), AT(batched, i, j));
+        }
+    }
+
+    Matrix* wrong = MATRIX(2, 4);
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_nn_forward_batch(nn, wrong));
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_nn_set_batch(nn, 0));
+    // a batch that cannot be allocated leaves every layer at the old size
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_nn_set_batch(nn, SIZE_MAX / 2));
+    for(size_t l = 0; l <= nn->count; ++l){
+        TEST_ASSERT_EQUAL_UINT64(1, nn->as[l]->rows);
+    }
+
+    mx_nn_free(nn);
+    mx_free(input);
+    mx_free(batched);
+    mx_free(wrong);
+}
+
+void test_nn_backprop_over_several_batches(void){
+    // more rows than MX_NN_BATCH, so gradients accumulate across batches
+    size_t arch[] = {2,3,1};
+    NN* nn = NN(arch);
+    NN* grad = NN(arch);
+    NN* part = NN(arch);
+    for(size_t l = 0; l < nn->count; ++l){
+        fill_pattern(nn->ws[l], 100 + l);
+        fill_pattern(nn->bs[l], 110 + l);
+    }
+    size_t n = MX_NN_BATCH + 45;
+    Matrix* ti = MATRIX(n, 2);
+    Matrix* to = MATRIX(n, 1);
+    fill_pattern(ti, 120);
+    fill_pattern(to, 121);
+
+    TEST_ASSERT_EQUAL(0, mx_nn_backprop(nn, grad, ti, to));
+
+    // the same gradient as a weighted average of per-row gradients
+    Matrix* row_in = MATRIX(1, 2);
+    Matrix* row_out = MATRIX(1, 1);
+    Matrix* expected = MATRIX(nn->ws[0]->rows, nn->ws[0]->cols);
+    for(size_t i = 0; i < n; ++i){
+        AT(row_in, 0, 0) = AT(ti, i, 0);
+        AT(row_in, 0, 1) = AT(ti, i, 1);
+        AT(row_out, 0, 0) = AT(to, i, 0);
+        TEST_ASSERT_EQUAL(0, mx_nn_backprop(nn, part, row_in, row_out));
+        AXPY(expected, 1.0f/n, part->ws[0]);
+    }
+    for(size_t i = 0; i < expected->rows; ++i){
+        for(size_t j = 0; j < expected->cols; ++j){
+            TEST_ASSERT_FLOAT_WITHIN(1e-5, AT(expected, i, j), AT(grad->ws[0], i, j));
+        }
+    }
+
+    mx_nn_free(nn);
+    mx_nn_free(grad);
+    mx_nn_free(part);
+    mx_free(ti);
+    mx_free(to);
+    mx_free(row_in);
+    mx_free(row_out);
+    mx_free(expected);
+}
+
 // Gradient descent with finite difference. This function should not have memory leaks
 void test_gradient_descent(void){
     size_t arch[] = {2,2,1};
@@ -1741,6 +3166,179 @@ void test_gradient_descent(void){
     mx_free(to);
 }
 
+static void write_dataset(const char* name, const Matrix* m) {
+    FILE* fp = fopen(name, "w");
+    TEST_ASSERT_NOT_NULL(fp);
+    for (size_t i = 0; i < m->rows; i++) {
+        for (size_t j = 0; j < m->cols; j++) {
+            fprintf(fp, j + 1 < m->cols ? "%.9g," : "%.9g\n", AT(m, i, j));
+        }
+    }
+    fclose(fp);
+}
+
+void test_open_dataset_formats(void) {
+    // rows far wider than the old 256 byte line buffer round-trip exactly
+    Matrix* wide = MATRIX(3, 300);
+    fill_pattern(wide, 21);
+    write_dataset("test_dataset.csv", wide);
+    Matrix* loaded = open_dataset("test_dataset.csv");
+    TEST_ASSERT_NOT_NULL(loaded);
+    TEST_ASSERT_EQUAL_UINT(3, loaded->rows);
+    TEST_ASSERT_EQUAL_UINT(300, loaded->cols);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(wide->container->data, loaded->container->data, 3 * 300);
+    mx_free(loaded);
+
+    FILE* fp = fopen("test_dataset.csv", "w");
+    TEST_ASSERT_NOT_NULL(fp);
+    fputs("\n 1, -2.5 ,+3e2\r\n\r\n.5,1E-3,-0\n12345678901234567890,1e-40,0.1", fp);
+    fclose(fp);
+    loaded = open_dataset("test_dataset.csv");
+    TEST_ASSERT_NOT_NULL(loaded);
+    TEST_ASSERT_EQUAL_UINT(3, loaded->rows);
+    TEST_ASSERT_EQUAL_UINT(3, loaded->cols);
+    const char* fields[] = {"1", "-2.5", "+3e2", ".5", "1E-3", "-0", "12345678901234567890", "1e-40", "0.1"};
+    for (size_t k = 0; k < 9; k++) {
+        TEST_ASSERT_EQUAL_FLOAT(strtof(fields[k], NULL), AT(loaded, k / 3, k % 3));
+    }
+    mx_free(loaded);
+
+    // a short row or a stray token fails the whole load
+    const char* bad[] = {"1,2\n3\n", "1,2\n3,x\n", "1,2,\n", "1e,2\n", ""};
+    for (size_t k = 0; k < 5; k++) {
+        fp = fopen("test_dataset.csv", "w");
+        TEST_ASSERT_NOT_NULL(fp);
+        fputs(bad[k], fp);
+        fclose(fp);
+        TEST_ASSERT_NULL(open_dataset("test_dataset.csv"));
+    }
+    TEST_ASSERT_NULL(open_dataset("./datasets/does_not_exist"));
+
+    remove("test_dataset.csv");
+    mx_free(wide);
+}
+
+void test_open_dataset_parallel_matches_serial(void) {
+    // large enough to be split into MX_CSV_CHUNK pieces
+    size_t rows = 2 * MX_CSV_CHUNK / 64 + 7;
+    Matrix* data = MATRIX(rows, 5);
+    fill_pattern(data, 22);
+    write_dataset("test_dataset.csv", data);
+
+    mx_set_num_threads(4);
+    Matrix* parallel = open_dataset("test_dataset.csv");
+    mx_set_num_threads(1);
+    Matrix* serial = open_dataset("test_dataset.csv");
+    mx_set_num_threads(0);
+
+    TEST_ASSERT_NOT_NULL(parallel);
+    TEST_ASSERT_NOT_NULL(serial);
+    TEST_ASSERT_EQUAL_UINT(rows, parallel->rows);
+    TEST_ASSERT_EQUAL_UINT(rows, serial->rows);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(data->container->data, parallel->container->data, rows * 5);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(data->container->data, serial->container->data, rows * 5);
+    mx_free(parallel);
+
+    // without a trailing newline the last chunk ends at the end of the mapping
+    FILE* fp = fopen("test_dataset.csv", "w");
+    TEST_ASSERT_NOT_NULL(fp);
+    for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < 5; j++) {
+            fprintf(fp, j ? ",%.9g" : "%.9g", AT(data, i, j));
+        }
+        if (i + 1 < rows) {
+            fputc('\n', fp);
+        }
+    }
+    fclose(fp);
+    mx_set_num_threads(4);
+    parallel = open_dataset("test_dataset.csv");
+    mx_set_num_threads(0);
+    TEST_ASSERT_NOT_NULL(parallel);
+    TEST_ASSERT_EQUAL_UINT(rows, parallel->rows);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(data->container->data, parallel->container->data, rows * 5);
+
+    remove("test_dataset.csv");
+    mx_free(data);
+    mx_free(parallel);
+    mx_free(serial);
+}
+
+void test_save_load_roundtrip(void) {
+    Matrix* dense = MATRIX(37, 19);
+    fill_pattern(dense, 23);
+    TEST_ASSERT_EQUAL(0, mx_save(dense, "test_matrix.mxb"));
+    Matrix* loaded = mx_load("test_matrix.mxb");
+    TEST_ASSERT_NOT_NULL(loaded);
+    TEST_ASSERT_EQUAL_UINT(37, loaded->rows);
+    TEST_ASSERT_EQUAL_UINT(19, loaded->cols);
+    TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)loaded->container->data % MX_ALIGN_MXB);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(dense->container->data, loaded->container->data, 37 * 19);
+
+    // the mapping is private: writes stay in memory and the loaded matrix works as any other
+    AT(loaded, 0, 0) = 1000;
+    Matrix* product = MATRIX(37, 37);
+    Matrix* dense_t = TRANSPOSE_VIEW(dense);
+    DOT(product, loaded, dense_t);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 1000 * AT(dense, 0, 0) + reference_dot_at(dense, dense_t, 0, 0) -
+                             AT(dense, 0, 0) * AT(dense, 0, 0), AT(product, 0, 0));
+    Matrix* reloaded = mx_load("test_matrix.mxb");
+    TEST_ASSERT_EQUAL_FLOAT(AT(dense, 0, 0), AT(reloaded, 0, 0));
+    mx_free(product);
+    mx_free(dense_t);
+    mx_free(reloaded);
+    mx_free(loaded);
+
+    // a transposed view keeps its strides, a padded view is packed
+    Matrix* transposed = TRANSPOSE_VIEW(dense);
+    TEST_ASSERT_EQUAL(0, mx_save(transposed, "test_matrix.mxb"));
+    loaded = mx_load("test_matrix.mxb");
+    TEST_ASSERT_NOT_NULL(loaded);
+    TEST_ASSERT_EQUAL_UINT(1, loaded->row_stride);
+    TEST_ASSERT_EQUAL_UINT(19, loaded->col_stride);
+    TEST_ASSERT_TRUE(mx_equal(transposed, loaded));
+    mx_free(loaded);
+
+    Matrix* padded = MATRIX_VIEW(dense);
+    padded->cols = 7;
+    TEST_ASSERT_EQUAL(0, mx_save(padded, "test_matrix.mxb"));
+    loaded = mx_load("test_matrix.mxb");
+    TEST_ASSERT_NOT_NULL(loaded);
+    TEST_ASSERT_EQUAL_UINT(7, loaded->row_stride);
+    TEST_ASSERT_TRUE(mx_equal(padded, loaded));
+    mx_free(loaded);
+
+    remove("test_matrix.mxb");
+    mx_free(padded);
+    mx_free(transposed);
+    mx_free(dense);
+}
+
+void test_load_invalid_files(void) {
+    Matrix* m = MATRIX(4, 4);
+    fill_pattern(m, 24);
+    TEST_ASSERT_EQUAL(0, mx_save(m, "test_matrix.mxb"));
+
+    // drop the last element
+    FILE* fp = fopen("test_matrix.mxb", "rb");
+    TEST_ASSERT_NOT_NULL(fp);
+    char bytes[64 + 16 * sizeof(precision_type)];
+    TEST_ASSERT_EQUAL_UINT(sizeof(bytes), fread(bytes, 1, sizeof(bytes), fp));
+    fclose(fp);
+    fp = fopen("test_matrix.mxb", "wb");
+    fwrite(bytes, 1, sizeof(bytes) - sizeof(precision_type), fp);
+    fclose(fp);
+    TEST_ASSERT_NULL(mx_load("test_matrix.mxb"));
+
+    // a CSV file is not an .mxb file
+    TEST_ASSERT_NULL(mx_load("./datasets/XOR"));
+    TEST_ASSERT_NULL(mx_load("./datasets/does_not_exist"));
+    TEST_ASSERT_EQUAL((uint8_t)-1, mx_save(NULL, "test_matrix.mxb"));
+
+    remove("test_matrix.mxb");
+    mx_free(m);
+}
+
 int main(void) {
     UNITY_BEGIN();
 
@@ -1811,6 +3409,29 @@ int main(void) {
     // RUN_TEST(test_dot_invalid_dimensions);
     RUN_TEST(test_dot_null_matrices);
     RUN_TEST(test_dot_matrix_and_its_transpose);
+    RUN_TEST(test_dot_new_auto_transpose_and_scalar);
+    RUN_TEST(test_fast_dot_blocked_matches_reference);
+    RUN_TEST(test_fast_dot_blocked_transposed_operands);
+    RUN_TEST(test_fast_dot_layouts_agree);
+    RUN_TEST(test_dot_vector_operands);
+    RUN_TEST(test_safe_dot_threaded_row_blocks);
+
+    // thread pool
+    RUN_TEST(test_parallel_for_visits_each_index_once);
+    RUN_TEST(test_thread_pool_kernels_match_serial);
+
+    // simd
+    RUN_TEST(test_simd_levels_match_scalar);
+    RUN_TEST(test_simd_sigmoid_extreme_inputs);
+
+    // elementwise ops
+    RUN_TEST(test_apply_op_matches_reference);
+    RUN_TEST(test_apply_op_special_values);
+    RUN_TEST(test_apply_op_strided_and_invalid);
+
+    // dense layer
+    RUN_TEST(test_dense_forward_matches_unfused);
+    RUN_TEST(test_dense_forward_invalid_arguments);
 
     // slice
     RUN_TEST(test_slice_valid_submatrix);
@@ -1818,10 +3439,12 @@ int main(void) {
     RUN_TEST(test_slice_null_matrix);
     RUN_TEST(test_slice_entire_matrix);
     RUN_TEST(test_slice_single_row_col);
+    RUN_TEST(test_slice_is_view);
 
     // macros
     RUN_TEST(test_AT_macro);
     RUN_TEST(test_MATRIX_macro);
+    RUN_TEST(test_MATRIX_macro_large_dimensions);
     RUN_TEST(test_MATRIX_VIEW_macro);
     RUN_TEST(test_MATRIX_COPY_macro);
     RUN_TEST(test_MATRIX_WITH_macro);
@@ -1860,6 +3483,18 @@ int main(void) {
     RUN_TEST(test_init_matrix_with_static_array);
     RUN_TEST(test_init_container_with_zero_size);
     RUN_TEST(test_init_matrix_with_dynamic_array);
+    RUN_TEST(test_matrix_wrap_borrows_buffer);
+    RUN_TEST(test_matrix_wrap_release_callback);
+    RUN_TEST(test_matrix_single_allocation);
+    RUN_TEST(test_matrix_padded_rows);
+
+    // arena
+    RUN_TEST(test_arena_temporaries);
+    RUN_TEST(test_arena_nested_scopes);
+    RUN_TEST(test_arena_nn_resized_in_scope);
+
+    // buffer pool
+    RUN_TEST(test_buffer_pool_steady_state);
 
     // self-dot
     RUN_TEST(test_self_dot_product_with_valid_row_vector);
@@ -1878,6 +3513,22 @@ int main(void) {
     RUN_TEST(test_memory_allocation_and_deallocation);
     RUN_TEST(test_invalid_matrix_dimensions);
 
+    // fixed-size matrices
+    RUN_TEST(test_small_matrix_ops);
+    RUN_TEST(test_small_matrix_interop);
+
+    // linear systems
+    RUN_TEST(test_lu_solve_many_right_hand_sides);
+    RUN_TEST(test_lu_pivoting_and_singular);
+    RUN_TEST(test_cholesky_solve);
+    RUN_TEST(test_triangular_kernels);
+    RUN_TEST(test_qr_factorization);
+    RUN_TEST(test_lstsq);
+
+    // spectral decompositions
+    RUN_TEST(test_symmetric_eigen);
+    RUN_TEST(test_truncated_svd);
+
     // Gilbert Strang Introduction to Linear Algebra 4th edition
     // Problem set 1.2 
     RUN_TEST(test_shwarz_inequality);
@@ -1903,6 +3554,16 @@ int main(void) {
 
     // Gradient descent
     RUN_TEST(test_gradient_descent);
+    RUN_TEST(test_nn_backprop_matches_finite_difference);
+    RUN_TEST(test_nn_backprop_invalid_data);
+    RUN_TEST(test_nn_forward_batch_matches_single_samples);
+    RUN_TEST(test_nn_backprop_over_several_batches);
+
+    // datasets
+    RUN_TEST(test_open_dataset_formats);
+    RUN_TEST(test_open_dataset_parallel_matches_serial);
+    RUN_TEST(test_save_load_roundtrip);
+    RUN_TEST(test_load_invalid_files);
 
     return UNITY_END();
 }